@@ -0,0 +1,780 @@
+// Microbenchmarks for engine subsystems.
+// Usage: benchmark [name...]   Runs every benchmark when no name is given.
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "collision.h"
+#include "entity_store.h"
+#include "job_system.h"
+#include "model_cache.h"
+#include "renderer.h"
+#include "transform_kernel.h"
+#include "camera.h"
+#include "voxel.h"
+#include "ship.h"
+
+using namespace SpaceGame;
+
+namespace {
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+class Timer {
+public:
+    Timer() : start_(std::chrono::steady_clock::now()) {}
+
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Small LCG so every run of a benchmark places things the same way
+class Random {
+public:
+    explicit Random(uint32_t seed) : seed_(seed) {}
+
+    // Uniform in [lo, hi)
+    double operator()(double lo, double hi) {
+        seed_ = seed_ * 1664525u + 1013904223u;
+        return lo + (hi - lo) * (seed_ >> 8) / 16777216.0;
+    }
+
+private:
+    uint32_t seed_;
+};
+
+// Software renderer drawing into an offscreen SCREEN_WIDTH x SCREEN_HEIGHT
+// surface, which outlives it
+class SoftwareTarget {
+public:
+    SoftwareTarget() : surface_(SDL_CreateSurface(SCREEN_WIDTH, SCREEN_HEIGHT, SDL_PIXELFORMAT_XRGB8888)) {
+        valid_ = surface_ && renderer_.initSoftware(surface_);
+    }
+
+    ~SoftwareTarget() {
+        renderer_.shutdown();
+        SDL_DestroySurface(surface_);
+    }
+
+    SoftwareTarget(const SoftwareTarget&) = delete;
+    SoftwareTarget& operator=(const SoftwareTarget&) = delete;
+
+    bool isValid() const { return valid_; }
+    Renderer& getRenderer() { return renderer_; }
+
+private:
+    SDL_Surface* surface_;
+    Renderer renderer_;
+    bool valid_;
+};
+
+// Solid ellipsoid, dense enough that most voxels are interior
+void buildHull(VoxelModel& model, int rx, int ry, int rz) {
+    Color hull(200, 200, 210);
+    Color stripe(120, 180, 255);
+    for (int z = -rz; z <= rz; ++z) {
+        for (int y = -ry; y <= ry; ++y) {
+            for (int x = -rx; x <= rx; ++x) {
+                double d = (double)(x * x) / (rx * rx) + (double)(y * y) / (ry * ry) + (double)(z * z) / (rz * rz);
+                if (d <= 1.0) {
+                    model.addVoxel({(int16_t)x, (int16_t)y, (int16_t)z, VoxelType::Hull, (y % 4 == 0) ? stripe : hull});
+                }
+            }
+        }
+    }
+}
+
+// Frame time of a 5x5 grid of overlapping ships, with and without the
+// renderer's depth sort
+void benchDepthSort() {
+    SoftwareTarget target;
+    if (!target.isValid()) {
+        std::cerr << "depth_sort: could not create software renderer" << std::endl;
+        return;
+    }
+    Renderer& renderer = target.getRenderer();
+
+    VoxelModel model;
+    buildHull(model, 12, 20, 5);
+
+    std::vector<Ship> ships(25);
+    for (size_t i = 0; i < ships.size(); ++i) {
+        ships[i].setVoxelModel(&model);
+        ships[i].setPosition(glm::dvec3((double)(i % 5) * 15.0 - 30.0, (double)(i / 5) * 15.0 - 30.0, (double)i * 4.0));
+        ships[i].setRotation(glm::dvec3(0.3 * i, 0.2 * i, 0.0));
+    }
+
+    Camera camera;
+    camera.setPosition(glm::dvec3(0, 0, -120));
+    camera.lookAt(glm::dvec3(0, 0, 0));
+
+    const int frames = 100;
+    for (RenderMode mode : { RenderMode::Voxels, RenderMode::Mesh }) {
+        renderer.setRenderMode(mode);
+        for (bool sorted : { false, true }) {
+            renderer.setDepthSort(sorted);
+
+            Timer timer;
+            for (int frame = 0; frame < frames; ++frame) {
+                renderer.clear();
+                for (const Ship& ship : ships) {
+                    renderer.drawShip(ship, camera);
+                }
+                renderer.present();
+            }
+
+            std::cout << "depth_sort: " << (mode == RenderMode::Mesh ? "mesh  " : "voxels")
+                      << (sorted ? " sorted  " : " unsorted") << " "
+                      << timer.elapsedMs() / frames << " ms/frame, "
+                      << renderer.getStats().quads + renderer.getStats().faces << " primitives" << std::endl;
+        }
+    }
+
+}
+
+// Fleet frame time as the projection thread count grows, with the busy time
+// of each thread in the last frame
+void benchProjection() {
+    SoftwareTarget target;
+    if (!target.isValid()) {
+        std::cerr << "projection: could not create software renderer" << std::endl;
+        return;
+    }
+    Renderer& renderer = target.getRenderer();
+
+    VoxelModel model;
+    buildHull(model, 16, 28, 6);
+
+    std::vector<Ship> ships(100);
+    for (size_t i = 0; i < ships.size(); ++i) {
+        ships[i].setVoxelModel(&model);
+        ships[i].setPosition(glm::dvec3((double)(i % 10) * 40.0 - 180.0, (double)(i / 10) * 40.0 - 180.0, 200.0));
+        ships[i].setRotation(glm::dvec3(0.1 * i, 0.2 * i, 0.0));
+    }
+
+    Camera camera;
+    camera.setPosition(glm::dvec3(0, 0, -250));
+    camera.lookAt(glm::dvec3(0, 0, 200));
+
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    const int frames = 30;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        JobSystem jobs(threads);
+        renderer.setJobSystem(&jobs);
+
+        Timer timer;
+        for (int frame = 0; frame < frames; ++frame) {
+            renderer.clear();
+            for (const Ship& ship : ships) {
+                renderer.drawShip(ship, camera);
+            }
+            renderer.present();
+        }
+
+        std::cout << "projection: " << threads << " threads " << timer.elapsedMs() / frames << " ms/frame, busy ms per thread:";
+        for (double ms : renderer.getThreadTimes()) {
+            std::cout << " " << ms;
+        }
+        std::cout << std::endl;
+        renderer.setJobSystem(nullptr);
+    }
+}
+
+// Frame time of 500 ships sharing one model, queued one drawShip call at a
+// time and as a single drawShips instance batch at several LOD thresholds
+void benchFleet() {
+    SoftwareTarget target;
+    if (!target.isValid()) {
+        std::cerr << "fleet: could not create software renderer" << std::endl;
+        return;
+    }
+    Renderer& renderer = target.getRenderer();
+
+    VoxelModel model;
+    buildHull(model, 16, 28, 6);
+
+    // A 10 x 10 x 5 block of ships, all inside the view
+    std::vector<Ship> ships(500);
+    std::vector<glm::dmat4> transforms;
+    for (size_t i = 0; i < ships.size(); ++i) {
+        ships[i].setVoxelModel(&model);
+        ships[i].setPosition(glm::dvec3((double)(i % 10) * 50.0 - 225.0,
+                                        (double)(i / 10 % 10) * 50.0 - 225.0,
+                                        (double)(i / 100) * 50.0 + 400.0));
+        ships[i].setRotation(glm::dvec3(0.1 * i, 0.2 * i, 0.0));
+        transforms.push_back(ships[i].getModelMatrix());
+    }
+
+    Camera camera;
+    camera.setPosition(glm::dvec3(0, 0, -250));
+    camera.lookAt(glm::dvec3(0, 0, 500));
+
+    JobSystem jobs;
+    renderer.setJobSystem(&jobs);
+
+    // Instanced runs sweep the LOD threshold; 0 draws every ship at full detail
+    struct Run {
+        bool instanced;
+        float lodThreshold;
+    };
+    const Run runs[] = { { false, 0.0f }, { true, 0.0f }, { true, 1.0f }, { true, 2.0f }, { true, 4.0f } };
+
+    const int frames = 20;
+    for (const Run& run : runs) {
+        renderer.setLodThreshold(run.lodThreshold);
+        Timer timer;
+        for (int frame = 0; frame < frames; ++frame) {
+            renderer.clear();
+            if (run.instanced) {
+                renderer.drawShips(model, transforms.data(), transforms.size(), camera);
+            } else {
+                for (const Ship& ship : ships) {
+                    renderer.drawShip(ship, camera);
+                }
+            }
+            renderer.present();
+        }
+        const RenderStats& stats = renderer.getStats();
+        std::cout << "fleet: " << (run.instanced ? "drawShips" : "drawShip ") << " lod " << run.lodThreshold
+                  << " px " << timer.elapsedMs() / frames << " ms/frame, " << stats.quads << " quads, "
+                  << stats.lodInstances << " ships at reduced detail" << std::endl;
+    }
+
+    renderer.setJobSystem(nullptr);
+}
+
+// Per-voxel cost of the transform kernel paths against the original
+// Camera::worldToScreen loop
+void benchTransform() {
+    VoxelModel model;
+    buildHull(model, 60, 100, 20);
+    const VoxelSoA& voxels = model.getSoA();
+
+    Ship ship;
+    ship.setVoxelModel(&model);
+    ship.setPosition(glm::dvec3(1000.0, 0.0, 2000.0));
+    ship.setRotation(glm::dvec3(0.3, 0.5, 0.1));
+
+    Camera camera;
+    camera.setPosition(glm::dvec3(1000.0, 0.0, 1800.0));
+    camera.lookAt(ship.getPosition());
+
+    glm::dmat4 modelMatrix = ship.getModelMatrix();
+    glm::dmat4 projection = camera.getProjectionMatrix(SCREEN_WIDTH, SCREEN_HEIGHT);
+    glm::dmat4 mvp = projection * camera.getViewMatrix() * modelMatrix;
+
+    TransformParams params;
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            params.mvp[col * 4 + row] = (float)mvp[col][row];
+        }
+    }
+    params.width = (float)SCREEN_WIDTH;
+    params.height = (float)SCREEN_HEIGHT;
+    params.pixelScale = (float)(projection[0][0] * 0.5 * SCREEN_WIDTH);
+
+    const int repeats = 10;
+    const double voxelCount = (double)voxels.size() * repeats;
+
+    size_t visible = 0;
+    Timer timer;
+    for (int r = 0; r < repeats; ++r) {
+        visible = 0;
+        for (const Voxel& voxel : model.getVoxels()) {
+            glm::dvec3 worldPos(modelMatrix * glm::dvec4(voxel.x, voxel.y, voxel.z, 1.0));
+            double screenX, screenY, depth;
+            if (camera.worldToScreen(worldPos, SCREEN_WIDTH, SCREEN_HEIGHT, screenX, screenY, depth)
+                && depth > 0.0 && depth < 1.0) {
+                visible++;
+            }
+        }
+    }
+    std::cout << "transform: worldToScreen " << timer.elapsedMs() * 1e6 / voxelCount
+              << " ns/voxel, " << visible << " of " << voxels.size() << " in depth range" << std::endl;
+
+    std::vector<ScreenQuad> out(voxels.size());
+    for (KernelPath path : { KernelPath::Scalar, KernelPath::SSE2, KernelPath::AVX2 }) {
+        if ((int)path > (int)getBestKernelPath()) {
+            continue;
+        }
+        setKernelPath(path);
+
+        Timer kernelTimer;
+        for (int r = 0; r < repeats; ++r) {
+            visible = transformVoxels(voxels, params, out.data());
+        }
+        std::cout << "transform: " << getKernelPathName(path) << " " << kernelTimer.elapsedMs() * 1e6 / voxelCount
+                  << " ns/voxel, " << visible << " visible" << std::endl;
+    }
+    setKernelPath(getBestKernelPath());
+}
+
+// Load time and file size of a ~1M voxel model saved in the legacy v1
+// format, the memory-mapped v2 format and the compressed v3 format
+void benchLoad() {
+    VoxelModel model;
+    buildHull(model, 100, 100, 25);
+
+    const struct {
+        const char* name;
+        const char* path;
+        FileFormat format;
+    } formats[] = {
+        { "v1", "benchmark_load_v1.bin", FileFormat::V1 },
+        { "v2", "benchmark_load_v2.bin", FileFormat::V2 },
+        { "v3", "benchmark_load_v3.bin", FileFormat::Compressed },
+    };
+
+    for (const auto& format : formats) {
+        if (!model.saveToFile(format.path, format.format)) {
+            std::cerr << "load: could not write " << format.path << std::endl;
+            continue;
+        }
+
+        const int repeats = 5;
+        VoxelModel loaded;
+        Timer timer;
+        for (int r = 0; r < repeats; ++r) {
+            loaded.loadFromFile(format.path);
+        }
+        double ms = timer.elapsedMs() / repeats;
+
+        std::ifstream file(format.path, std::ios::binary | std::ios::ate);
+        std::cout << "load: " << format.name << " " << (long long)file.tellg() << " bytes, " << ms << " ms, "
+                  << loaded.getVoxels().size() / ms * 1e-3 << " M voxels/s, "
+                  << loaded.getVoxels().size() << " voxels" << std::endl;
+        file.close();
+        std::remove(format.path);
+    }
+}
+
+// Moving and re-matrixing 10k entities: Ship objects updated through the
+// virtual Entity interface, the same with the original three-glm::rotate
+// matrix, and the EntityStore systems
+void benchEntities() {
+    const size_t count = 10000;
+    const int frames = 100;
+    const double deltaTime = 1.0 / 60.0;
+
+    auto velocityOf = [](size_t i) { return glm::dvec3(0.1 * (double)(i % 7), 0.0, 1.0); };
+    auto spinOf = [](size_t i) { return glm::dvec3(0.0, 0.01 * (double)(i % 13), 0.02); };
+
+    std::vector<std::unique_ptr<Entity>> ships;
+    for (size_t i = 0; i < count; ++i) {
+        auto ship = std::make_unique<Ship>();
+        ship->setPosition(glm::dvec3((double)i, 0.0, 0.0));
+        ships.push_back(std::move(ship));
+    }
+
+    // Keeps the matrices observable so the loops are not optimised away
+    double checksum = 0.0;
+
+    for (bool rotateCalls : { true, false }) {
+        Timer timer;
+        for (int frame = 0; frame < frames; ++frame) {
+            for (size_t i = 0; i < count; ++i) {
+                Entity& entity = *ships[i];
+                entity.setPosition(entity.getPosition() + velocityOf(i) * deltaTime);
+                entity.setRotation(entity.getRotation() + spinOf(i) * deltaTime);
+                entity.update(deltaTime);
+                if (rotateCalls) {
+                    glm::dmat4 model = glm::translate(glm::dmat4(1.0), entity.getPosition());
+                    model = glm::rotate(model, entity.getRotation().x, glm::dvec3(1, 0, 0));
+                    model = glm::rotate(model, entity.getRotation().y, glm::dvec3(0, 1, 0));
+                    model = glm::rotate(model, entity.getRotation().z, glm::dvec3(0, 0, 1));
+                    model = glm::scale(model, entity.getScale());
+                    checksum += model[3][0];
+                } else {
+                    checksum += entity.getModelMatrix()[3][0];
+                }
+            }
+        }
+        std::cout << "entities: Ship::update" << (rotateCalls ? " + glm::rotate " : "                ")
+                  << timer.elapsedMs() / frames << " ms/frame" << std::endl;
+    }
+
+    EntityStore store;
+    store.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        EntityId id = store.create(nullptr, glm::dvec3((double)i, 0.0, 0.0));
+        store.setVelocity(id, velocityOf(i));
+        store.setAngularVelocity(id, spinOf(i));
+    }
+
+    JobSystem jobs;
+    for (JobSystem* system : { (JobSystem*)nullptr, &jobs }) {
+        Timer timer;
+        for (int frame = 0; frame < frames; ++frame) {
+            store.integrate(deltaTime);
+            store.updateMatrices(system);
+            checksum += store.getMatrices()[count - 1][3][0];
+        }
+        std::cout << "entities: EntityStore " << (system ? jobs.getThreadCount() : 1) << " threads  "
+                  << timer.elapsedMs() / frames << " ms/frame" << std::endl;
+    }
+
+    if (checksum == 0.0) {
+        std::cout << "entities: unexpected zero checksum" << std::endl;
+    }
+}
+
+// Frame interval jitter of the original loop (millisecond SDL_GetTicks and a
+// relative SDL_Delay) against nanosecond timing with absolute deadlines and
+// SDL_DelayPrecise, with a few milliseconds of varying work per frame
+void benchPacing() {
+    const int frames = 120;
+    const Uint64 frameNs = 1000000000ull / 60;
+
+    auto work = [](int frame) {
+        Uint64 until = SDL_GetTicksNS() + 3000000ull + (Uint64)(frame % 5) * 700000ull;
+        while (SDL_GetTicksNS() < until) {
+        }
+    };
+    auto report = [](const char* name, const std::vector<double>& intervals) {
+        double sum = 0.0, squares = 0.0;
+        for (double ms : intervals) {
+            sum += ms;
+            squares += ms * ms;
+        }
+        double mean = sum / intervals.size();
+        std::cout << "pacing: " << name << " " << mean << " ms mean, "
+                  << std::sqrt(std::max(0.0, squares / intervals.size() - mean * mean)) << " ms deviation" << std::endl;
+    };
+
+    std::vector<double> intervals;
+    Uint64 last = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; ++frame) {
+        Uint64 frameStart = SDL_GetTicks();
+        work(frame);
+        Uint64 frameTime = SDL_GetTicks() - frameStart;
+        if (1000.0 / 60.0 > frameTime) {
+            SDL_Delay((Uint32)(1000.0 / 60.0 - frameTime));
+        }
+        Uint64 now = SDL_GetTicksNS();
+        intervals.push_back((now - last) * 1e-6);
+        last = now;
+    }
+    report("SDL_Delay         ", intervals);
+
+    intervals.clear();
+    last = SDL_GetTicksNS();
+    Uint64 nextFrame = last + frameNs;
+    for (int frame = 0; frame < frames; ++frame) {
+        work(frame);
+        Uint64 now = SDL_GetTicksNS();
+        if (now < nextFrame) {
+            SDL_DelayPrecise(nextFrame - now);
+            nextFrame += frameNs;
+        } else {
+            nextFrame = now + frameNs;
+        }
+        now = SDL_GetTicksNS();
+        intervals.push_back((now - last) * 1e-6);
+        last = now;
+    }
+    report("deadline + precise", intervals);
+}
+
+// Sustained combat on a ~500k voxel hull: 300 blasts and 300 ray hits a
+// second at 60 frames a second, with the surface, bounds and LOD chain the
+// renderer needs refreshed every frame. Compared against rebuilding those
+// from scratch after each frame's hits.
+void benchDamage() {
+    VoxelModel model;
+    buildHull(model, 40, 30, 100);
+
+    auto refresh = [](const VoxelModel& m) {
+        glm::dvec3 center;
+        double radius;
+        m.getBoundingSphere(center, radius);
+        size_t count = m.getSurfaceVoxelCount();
+        for (int level = 1; level < VoxelModel::MAX_LOD_LEVELS; ++level) {
+            count += m.getLod(level).getSurfaceVoxelCount();
+        }
+        return count;
+    };
+    refresh(model);
+
+    const int frames = 60;
+    const int hitsPerFrame = 5;
+    Random random(12345);
+
+    size_t checksum = 0;
+    DamageResult total;
+    double damageMs = 0.0;
+    double rebuildMs = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        Timer timer;
+        for (int hit = 0; hit < hitsPerFrame; ++hit) {
+            glm::dvec3 center(random(-40, 40), random(-30, 30), random(-100, 100));
+            DamageResult blast = model.applyBlast(center, random(2.0, 6.0), random(0.3, 1.5));
+            glm::dvec3 origin(random(-40, 40), random(-30, 30), -150.0);
+            DamageResult ray = model.applyRayHit(origin, glm::dvec3(0, 0, 1), 300.0, 0.5);
+            total.damaged += blast.damaged + ray.damaged;
+            total.destroyed += blast.destroyed + ray.destroyed;
+        }
+        checksum += refresh(model);
+        damageMs += timer.elapsedMs();
+
+        // What the same frame cost when any change meant rebuilding the
+        // derived data of the whole model
+        if (frame % 10 == 0) {
+            Timer rebuild;
+            VoxelModel copy;
+            copy.setVoxels(model.getVoxels());
+            checksum += refresh(copy);
+            rebuildMs += rebuild.elapsedMs();
+        }
+    }
+
+    std::cout << "damage: " << model.getVoxels().size() << " voxels left, " << total.damaged << " damaged, "
+              << total.destroyed << " destroyed" << std::endl;
+    std::cout << "damage: incremental " << damageMs / frames << " ms/frame, full rebuild "
+              << rebuildMs / (frames / 10) << " ms/frame" << std::endl;
+    if (checksum == 0) {
+        std::cout << "damage: unexpected empty surface" << std::endl;
+    }
+}
+
+// Per-ray cost on a ~500k voxel hull of testing every voxel's cube, of the
+// brick-skipping DDA, and of the batched DDA across the job system
+void benchRaycast() {
+    VoxelModel model;
+    buildHull(model, 40, 30, 100);
+
+    // Rays from a shell around the hull towards points scattered through and
+    // around its box, so a share of them miss
+    Random random(777);
+    std::vector<Ray> rays(100000);
+    for (Ray& ray : rays) {
+        glm::dvec3 target(random(-50, 50), random(-40, 40), random(-110, 110));
+        ray.origin = glm::normalize(glm::dvec3(random(-1, 1), random(-1, 1), random(-1, 1))) * 200.0;
+        ray.direction = glm::normalize(target - ray.origin);
+        ray.maxDistance = 400.0;
+    }
+
+    auto bruteForce = [&model](const Ray& ray, RayHit& hit) {
+        bool found = false;
+        hit.distance = ray.maxDistance;
+        for (const Voxel& v : model.getVoxels()) {
+            glm::dvec3 center(v.x, v.y, v.z);
+            glm::dvec3 t0 = (center - 0.5 - ray.origin) / ray.direction;
+            glm::dvec3 t1 = (center + 0.5 - ray.origin) / ray.direction;
+            glm::dvec3 near = glm::min(t0, t1);
+            glm::dvec3 far = glm::max(t0, t1);
+            double enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0));
+            double exit = std::min(std::min(far.x, far.y), far.z);
+            if (enter <= exit && enter <= hit.distance) {
+                hit.x = v.x;
+                hit.y = v.y;
+                hit.z = v.z;
+                hit.distance = enter;
+                found = true;
+            }
+        }
+        return found;
+    };
+
+    const size_t bruteRays = 50;
+    int mismatches = 0;
+    Timer bruteTimer;
+    for (size_t i = 0; i < bruteRays; ++i) {
+        RayHit expected, actual;
+        bool hit = bruteForce(rays[i], expected);
+        if (hit != model.raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, actual) ||
+            (hit && std::abs(expected.distance - actual.distance) > 1e-6)) {
+            mismatches++;
+        }
+    }
+    double bruteUs = bruteTimer.elapsedMs() * 1000.0 / bruteRays;
+
+    std::vector<RayHit> hits(rays.size());
+    std::unique_ptr<bool[]> found(new bool[rays.size()]);
+    size_t hitCount = 0;
+    Timer ddaTimer;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        found[i] = model.raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+        hitCount += found[i];
+    }
+    double ddaUs = ddaTimer.elapsedMs() * 1000.0 / rays.size();
+
+    JobSystem jobs;
+    Timer batchTimer;
+    size_t batchHits = model.raycast(rays.data(), rays.size(), hits.data(), found.get(), &jobs);
+    double batchUs = batchTimer.elapsedMs() * 1000.0 / rays.size();
+
+    std::cout << "raycast: " << model.getVoxels().size() << " voxels, " << hitCount << " of " << rays.size()
+              << " rays hit, " << mismatches << " mismatches against brute force" << std::endl;
+    std::cout << "raycast: brute force " << bruteUs << " us/ray, DDA " << ddaUs << " us/ray, batched "
+              << jobs.getThreadCount() << " threads " << batchUs << " us/ray" << std::endl;
+    if (batchHits != hitCount) {
+        std::cout << "raycast: batched hit count differs" << std::endl;
+    }
+}
+
+// 1000 ships drifting through a shared volume, each tick running the
+// sweep-and-prune broadphase and bitmask narrowphase, against testing every
+// pair's world boxes
+void benchCollision() {
+    VoxelModel model;
+    buildHull(model, 6, 4, 14);
+
+    const size_t count = 1000;
+    const int ticks = 120;
+    const double tickSeconds = 1.0 / 60.0;
+    Random random(99);
+
+    EntityStore world;
+    world.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        EntityId id = world.create(borrowModel(model), glm::dvec3(random(-300, 300), random(-300, 300), random(-300, 300)),
+                                   glm::dvec3(random(0, 6.3), random(0, 6.3), 0.0));
+        world.setVelocity(id, glm::dvec3(random(-20, 20), random(-20, 20), random(-20, 20)));
+        world.setAngularVelocity(id, glm::dvec3(0.0, random(-1, 1), random(-1, 1)));
+    }
+
+    CollisionSystem collisions;
+    uint64_t pairs = 0, contacts = 0, swaps = 0;
+    double collisionMs = 0.0;
+    for (int tick = 0; tick < ticks; ++tick) {
+        world.integrate(tickSeconds);
+        Timer timer;
+        collisions.update(world);
+        collisionMs += timer.elapsedMs();
+        pairs += collisions.getStats().pairs;
+        contacts += collisions.getStats().contacts;
+        swaps += collisions.getStats().swaps;
+    }
+
+    // The same boxes tested all against all
+    glm::dvec3 localMin, localMax;
+    model.getBounds(localMin, localMax);
+    std::vector<glm::dvec3> mins(count), maxs(count);
+    uint64_t naivePairs = 0;
+    Timer naiveTimer;
+    for (int tick = 0; tick < 10; ++tick) {
+        const std::vector<glm::dmat4>& matrices = world.getMatrices();
+        for (size_t i = 0; i < count; ++i) {
+            glm::dvec3 center(matrices[i] * glm::dvec4((localMin + localMax) * 0.5, 1.0));
+            double radius = glm::length(localMax - localMin) * 0.5;
+            mins[i] = center - radius;
+            maxs[i] = center + radius;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = i + 1; j < count; ++j) {
+                naivePairs += mins[i].x <= maxs[j].x && mins[j].x <= maxs[i].x &&
+                              mins[i].y <= maxs[j].y && mins[j].y <= maxs[i].y &&
+                              mins[i].z <= maxs[j].z && mins[j].z <= maxs[i].z;
+            }
+        }
+    }
+
+    std::cout << "collision: " << count << " ships, " << (double)pairs / ticks << " box pairs/tick, "
+              << (double)contacts / ticks << " contacts/tick, " << (double)swaps / ticks << " sort moves/tick"
+              << std::endl;
+    std::cout << "collision: sweep-and-prune + bitmask narrowphase " << collisionMs / ticks
+              << " ms/tick, all-pairs box test alone " << naiveTimer.elapsedMs() / 10 << " ms/tick ("
+              << naivePairs / 10 << " pairs)" << std::endl;
+}
+
+// Four hull files loaded the way the game did before the cache, reading and
+// building derived data on the calling thread, against the calling thread's
+// stall in ModelCache::load and the wait for every future to resolve
+void benchModelCache() {
+    const char* paths[] = {
+        "benchmark_cache_0.bin", "benchmark_cache_1.bin", "benchmark_cache_2.bin", "benchmark_cache_3.bin",
+    };
+    const int count = (int)(sizeof(paths) / sizeof(paths[0]));
+    for (int i = 0; i < count; ++i) {
+        VoxelModel model;
+        buildHull(model, 60 + 10 * i, 40, 20);
+        model.saveToFile(paths[i], FileFormat::Compressed);
+    }
+
+    Timer syncTimer;
+    for (int i = 0; i < count; ++i) {
+        VoxelModel model;
+        model.loadFromFile(paths[i]);
+        glm::dvec3 min, max;
+        model.getBounds(min, max);
+        model.getOccupancy();
+        for (int level = 1; level < VoxelModel::MAX_LOD_LEVELS; ++level) {
+            model.getLod(level).getSurface();
+        }
+    }
+    double syncMs = syncTimer.elapsedMs();
+
+    ModelCache cache;
+    std::vector<ModelHandle> handles;
+    Timer stallTimer;
+    for (int i = 0; i < count; ++i) {
+        handles.push_back(cache.load(paths[i]));
+    }
+    double stallMs = stallTimer.elapsedMs();
+    for (const ModelHandle& handle : handles) {
+        handle.getFuture().wait();
+    }
+    double readyMs = stallTimer.elapsedMs();
+    cache.update();
+
+    // A second load of a path, spelled differently, shares the first model
+    ModelHandle again = cache.load(std::string("./") + paths[0]);
+    bool shared = again.get() == handles[0].get() && again.isReady();
+
+    std::cout << "model_cache: " << count << " files, synchronous load " << syncMs << " ms on the caller, "
+              << "cached load " << stallMs << " ms on the caller, " << readyMs << " ms until all ready, "
+              << "repeat load " << (shared ? "shared" : "NOT shared") << std::endl;
+
+    for (const char* path : paths) {
+        std::remove(path);
+    }
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+    { "depth_sort", benchDepthSort },
+    { "projection", benchProjection },
+    { "fleet", benchFleet },
+    { "transform", benchTransform },
+    { "load", benchLoad },
+    { "entities", benchEntities },
+    { "pacing", benchPacing },
+    { "damage", benchDamage },
+    { "raycast", benchRaycast },
+    { "collision", benchCollision },
+    { "model_cache", benchModelCache },
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (const Benchmark& benchmark : BENCHMARKS) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], benchmark.name) == 0) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            benchmark.run();
+        }
+    }
+    return 0;
+}
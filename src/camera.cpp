@@ -4,6 +4,53 @@
 
 namespace SpaceGame {
 
+Frustum Frustum::fromMatrix(const glm::dmat4& m) {
+    // Gribb-Hartmann: each plane is the w row plus or minus another row
+    glm::dvec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::dvec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    // Normalize so sphere tests can compare distances against radii
+    for (auto& plane : frustum.planes) {
+        double length = glm::length(glm::dvec3(plane));
+        if (length > 0.0) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::dvec3& center, double radius) const {
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::dvec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const glm::dvec3& min, const glm::dvec3& max) const {
+    for (const auto& plane : planes) {
+        // Test the corner farthest along the plane normal
+        glm::dvec3 corner(plane.x >= 0.0 ? max.x : min.x,
+                          plane.y >= 0.0 ? max.y : min.y,
+                          plane.z >= 0.0 ? max.z : min.z);
+        if (glm::dot(glm::dvec3(plane), corner) + plane.w < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 Camera::Camera()
     : position_(0.0, 0.0, 0.0),
       pitch_(0.0),
@@ -25,7 +72,9 @@ void Camera::lookAt(const glm::dvec3& target, const glm::dvec3& up) {
 }
 
 glm::dmat4 Camera::getViewMatrix() const {
-    glm::dmat4 view = glm::dmat4(1.0);
+    // The camera looks down +Z (see lookAt and moveForward) while the
+    // projection expects -Z, so mirror Z after rotating into view space
+    glm::dmat4 view = glm::scale(glm::dmat4(1.0), glm::dvec3(1, 1, -1));
     view = glm::rotate(view, -pitch_, glm::dvec3(1, 0, 0));
     view = glm::rotate(view, -yaw_, glm::dvec3(0, 1, 0));
     view = glm::rotate(view, -roll_, glm::dvec3(0, 0, 1));
@@ -37,6 +86,14 @@ glm::dmat4 Camera::getProjectionMatrix(int screenWidth, int screenHeight) const
     return glm::perspective(glm::radians(fov_), (double)screenWidth / (double)screenHeight, 0.1, 1000.0);
 }
 
+glm::dmat4 Camera::getViewProjectionMatrix(int screenWidth, int screenHeight) const {
+    return getProjectionMatrix(screenWidth, screenHeight) * getViewMatrix();
+}
+
+Frustum Camera::getFrustum(int screenWidth, int screenHeight) const {
+    return Frustum::fromMatrix(getViewProjectionMatrix(screenWidth, screenHeight));
+}
+
 void Camera::moveForward(double distance) {
     double yawRad = yaw_;
     double pitchRad = pitch_;
@@ -67,9 +124,7 @@ void Camera::rotate(double deltaPitch, double deltaYaw, double deltaRoll) {
 
 bool Camera::worldToScreen(const glm::dvec3& worldPos, int screenWidth, int screenHeight,
                            double& screenX, double& screenY, double& depth) const {
-    glm::dmat4 view = getViewMatrix();
-    glm::dmat4 proj = getProjectionMatrix(screenWidth, screenHeight);
-    glm::dmat4 viewProj = proj * view;
+    glm::dmat4 viewProj = getViewProjectionMatrix(screenWidth, screenHeight);
 
     glm::dvec4 clipPos = viewProj * glm::dvec4(worldPos, 1.0);
 
@@ -5,6 +5,19 @@
 
 namespace SpaceGame {
 
+// Six clip planes stored as (normal, distance) with normals pointing inward,
+// so a point p is inside a plane when dot(normal, p) + distance >= 0
+struct Frustum {
+    glm::dvec4 planes[6];   // Left, right, bottom, top, near, far
+
+    // Extracts the planes of a view-projection matrix in world space, or of a
+    // full model-view-projection matrix in that model's local space
+    static Frustum fromMatrix(const glm::dmat4& matrix);
+
+    bool intersectsSphere(const glm::dvec3& center, double radius) const;
+    bool intersectsBox(const glm::dvec3& min, const glm::dvec3& max) const;
+};
+
 class Camera {
 public:
     Camera();
@@ -20,6 +33,8 @@ public:
 
     glm::dmat4 getViewMatrix() const;
     glm::dmat4 getProjectionMatrix(int screenWidth, int screenHeight) const;
+    glm::dmat4 getViewProjectionMatrix(int screenWidth, int screenHeight) const;
+    Frustum getFrustum(int screenWidth, int screenHeight) const;
 
     // Convert 3D world position to 2D screen position
     bool worldToScreen(const glm::dvec3& worldPos, int screenWidth, int screenHeight,
@@ -0,0 +1,250 @@
+#include "collision.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace SpaceGame {
+
+namespace {
+
+int popcount64(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((v * 0x0101010101010101ull) >> 56);
+}
+
+// Box enclosing the transformed box, from the centre and the absolute
+// values of the rotation-scale part
+void transformBox(const glm::dmat4& m, const glm::dvec3& min, const glm::dvec3& max,
+                  glm::dvec3& outMin, glm::dvec3& outMax) {
+    glm::dvec3 center = (min + max) * 0.5;
+    glm::dvec3 extent = (max - min) * 0.5;
+    glm::dvec3 c(m * glm::dvec4(center, 1.0));
+    glm::dvec3 e;
+    for (int row = 0; row < 3; ++row) {
+        e[row] = std::abs(m[0][row]) * extent.x + std::abs(m[1][row]) * extent.y + std::abs(m[2][row]) * extent.z;
+    }
+    outMin = c - e;
+    outMax = c + e;
+}
+
+bool boxesOverlap(const glm::dvec3& aMin, const glm::dvec3& aMax, const glm::dvec3& bMin, const glm::dvec3& bMax) {
+    return aMin.x <= bMax.x && bMin.x <= aMax.x &&
+           aMin.y <= bMax.y && bMin.y <= aMax.y &&
+           aMin.z <= bMax.z && bMin.z <= aMax.z;
+}
+
+// Cells of b landing in one brick of a
+struct BrickMask {
+    uint32_t brick;     // Index into a's bricks
+    uint64_t bits[BrickOccupancy::WORDS];
+};
+
+} // namespace
+
+uint32_t overlapVoxels(const VoxelModel& a, const glm::dmat4& aToWorld,
+                       const VoxelModel& b, const glm::dmat4& bToWorld,
+                       glm::dvec3* point) {
+    if (a.getVoxels().empty() || b.getVoxels().empty()) {
+        return 0;
+    }
+
+    // Everything happens in a's model space
+    glm::dmat4 bToA = glm::inverse(aToWorld) * bToWorld;
+    glm::dvec3 aMin, aMax, bMin, bMax;
+    a.getBounds(aMin, aMax);
+    b.getBounds(bMin, bMax);
+    transformBox(bToA, bMin, bMax, bMin, bMax);
+    if (!boxesOverlap(aMin, aMax, bMin, bMax)) {
+        return 0;
+    }
+    glm::dvec3 sharedMin = glm::max(aMin, bMin);
+    glm::dvec3 sharedMax = glm::min(aMax, bMax);
+
+    const VoxelIndex& aIndex = a.getIndex();
+    const std::vector<BrickOccupancy>& aOccupancy = a.getOccupancy();
+    const int shift = VoxelIndex::BRICK_SHIFT;
+
+    std::vector<BrickMask> masks;
+    std::unordered_map<uint32_t, uint32_t> maskOf;
+
+    // Columns of bToA; a cell's position is the brick origin's plus whole
+    // steps along them
+    const glm::dvec3 axisX(bToA[0]);
+    const glm::dvec3 axisY(bToA[1]);
+    const glm::dvec3 axisZ(bToA[2]);
+
+    // Rasterise b's voxels onto a's grid, only from bricks whose box reaches
+    // the region both models cover
+    for (const VoxelIndex::Brick& brick : b.getIndex().getBricks()) {
+        if (brick.count == 0) {
+            continue;
+        }
+        glm::dvec3 base(brick.x << shift, brick.y << shift, brick.z << shift);
+        glm::dvec3 boxMin, boxMax;
+        transformBox(bToA, base - 0.5, base + (VoxelIndex::BRICK_SIZE - 0.5), boxMin, boxMax);
+        if (!boxesOverlap(boxMin, boxMax, sharedMin, sharedMax)) {
+            continue;
+        }
+        const glm::dvec3 origin(bToA * glm::dvec4(base, 1.0));
+
+        int lastBrick[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+        BrickMask* mask = nullptr;
+        for (int cell = 0; cell < VoxelIndex::BRICK_VOLUME; ++cell) {
+            if (brick.slots[cell] == VoxelIndex::NONE) {
+                continue;
+            }
+            glm::dvec3 q = origin + axisX * (double)(cell & VoxelIndex::BRICK_MASK)
+                                  + axisY * (double)((cell >> shift) & VoxelIndex::BRICK_MASK)
+                                  + axisZ * (double)(cell >> (2 * shift));
+            if (q.x < aMin.x || q.y < aMin.y || q.z < aMin.z || q.x > aMax.x || q.y > aMax.y || q.z > aMax.z) {
+                continue;
+            }
+            int x = (int)std::floor(q.x + 0.5);
+            int y = (int)std::floor(q.y + 0.5);
+            int z = (int)std::floor(q.z + 0.5);
+
+            // Neighbouring voxels of b mostly land in the same brick of a
+            if ((x >> shift) != lastBrick[0] || (y >> shift) != lastBrick[1] || (z >> shift) != lastBrick[2]) {
+                lastBrick[0] = x >> shift;
+                lastBrick[1] = y >> shift;
+                lastBrick[2] = z >> shift;
+                uint32_t target = aIndex.findBrick((int16_t)lastBrick[0], (int16_t)lastBrick[1], (int16_t)lastBrick[2]);
+                mask = nullptr;
+                if (target != VoxelIndex::NONE) {
+                    auto found = maskOf.emplace(target, (uint32_t)masks.size());
+                    if (found.second) {
+                        masks.push_back(BrickMask{ target, {} });
+                    }
+                    mask = &masks[found.first->second];
+                }
+            }
+            if (mask) {
+                int bit = VoxelIndex::cellIndex((int16_t)x, (int16_t)y, (int16_t)z);
+                mask->bits[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+    }
+
+    uint32_t count = 0;
+    glm::dvec3 sum(0.0);
+    const auto& aBricks = aIndex.getBricks();
+    for (const BrickMask& mask : masks) {
+        const BrickOccupancy& occupancy = aOccupancy[mask.brick];
+        for (int word = 0; word < BrickOccupancy::WORDS; ++word) {
+            uint64_t both = mask.bits[word] & occupancy.bits[word];
+            if (both == 0) {
+                continue;
+            }
+            count += popcount64(both);
+            if (point) {
+                const VoxelIndex::Brick& brick = aBricks[mask.brick];
+                for (int bit = 0; bit < 64; ++bit) {
+                    if (both & (1ull << bit)) {
+                        int cell = word * 64 + bit;
+                        sum += glm::dvec3((brick.x << shift) + (cell & VoxelIndex::BRICK_MASK),
+                                          (brick.y << shift) + ((cell >> shift) & VoxelIndex::BRICK_MASK),
+                                          (brick.z << shift) + (cell >> (2 * shift)));
+                    }
+                }
+            }
+        }
+    }
+
+    if (point && count > 0) {
+        *point = glm::dvec3(aToWorld * glm::dvec4(sum / (double)count, 1.0));
+    }
+    return count;
+}
+
+void CollisionSystem::update(EntityStore& world, JobSystem* jobs) {
+    world.updateMatrices(jobs);
+    const std::vector<EntityId>& ids = world.getIds();
+    const std::vector<ModelRef>& models = world.getModels();
+    const std::vector<glm::dmat4>& matrices = world.getMatrices();
+
+    stats_ = CollisionStats();
+    contacts_.clear();
+
+    // Drop destroyed entities without disturbing the order of the rest
+    size_t kept = 0;
+    for (const Proxy& proxy : proxies_) {
+        if (world.isAlive(proxy.id) && models[world.indexOf(proxy.id)]) {
+            proxies_[kept++] = proxy;
+        } else {
+            tracked_[proxy.id] = 0;
+        }
+    }
+    proxies_.resize(kept);
+
+    // New entities join at the end and sort into place below
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!models[i]) {
+            continue;
+        }
+        if (ids[i] >= tracked_.size()) {
+            tracked_.resize(ids[i] + 1, 0);
+        }
+        if (!tracked_[ids[i]]) {
+            tracked_[ids[i]] = 1;
+            proxies_.push_back({ ids[i], glm::dvec3(0.0), glm::dvec3(0.0) });
+        }
+    }
+
+    for (Proxy& proxy : proxies_) {
+        uint32_t index = world.indexOf(proxy.id);
+        glm::dvec3 min, max;
+        models[index]->getBounds(min, max);
+        transformBox(matrices[index], min, max, proxy.min, proxy.max);
+    }
+
+    // Entities move a little per tick, so the list is nearly sorted already
+    for (size_t i = 1; i < proxies_.size(); ++i) {
+        Proxy moving = proxies_[i];
+        size_t j = i;
+        while (j > 0 && proxies_[j - 1].min.x > moving.min.x) {
+            proxies_[j] = proxies_[j - 1];
+            --j;
+            stats_.swaps++;
+        }
+        proxies_[j] = moving;
+    }
+    stats_.proxies = (uint32_t)proxies_.size();
+
+    // Sweep along x; only boxes starting before this one ends can overlap it
+    for (size_t i = 0; i < proxies_.size(); ++i) {
+        const Proxy& first = proxies_[i];
+        for (size_t j = i + 1; j < proxies_.size() && proxies_[j].min.x <= first.max.x; ++j) {
+            const Proxy& second = proxies_[j];
+            if (!boxesOverlap(first.min, first.max, second.min, second.max)) {
+                continue;
+            }
+            stats_.pairs++;
+
+            // Rasterise the model with fewer voxels onto the other's grid
+            uint32_t ia = world.indexOf(first.id);
+            uint32_t ib = world.indexOf(second.id);
+            if (models[ia]->getVoxels().size() < models[ib]->getVoxels().size()) {
+                std::swap(ia, ib);
+            }
+            Contact contact;
+            contact.voxels = overlapVoxels(*models[ia], matrices[ia], *models[ib], matrices[ib], &contact.point);
+            if (contact.voxels > 0) {
+                contact.a = ids[ia];
+                contact.b = ids[ib];
+                contacts_.push_back(contact);
+            }
+        }
+    }
+    stats_.contacts = (uint32_t)contacts_.size();
+}
+
+void CollisionSystem::clear() {
+    proxies_.clear();
+    tracked_.clear();
+    contacts_.clear();
+    stats_ = CollisionStats();
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include "entity_store.h"
+#include "job_system.h"
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// Two entities whose voxels overlap
+struct Contact {
+    EntityId a, b;
+    uint32_t voxels;        // Overlapping cells, counted on a's grid
+    glm::dvec3 point;       // World-space centre of the overlapping cells
+};
+
+// Counters from the last CollisionSystem::update
+struct CollisionStats {
+    uint32_t proxies = 0;       // Entities with a model in the broadphase
+    uint32_t swaps = 0;         // Insertion sort moves keeping the axis sorted
+    uint32_t pairs = 0;         // Pairs whose world boxes overlap
+    uint32_t contacts = 0;      // Pairs whose voxels overlap
+};
+
+// Counts the voxels of two posed models that occupy the same cell. b's
+// voxels in bricks near the overlap are moved onto a's grid, rounded to the
+// nearest cell and gathered into per-brick bitmasks, which are ANDed a word
+// at a time with a's occupancy. Assumes both models are at a similar scale.
+// When point is given and the count is non-zero it receives the world-space
+// centre of the overlapping cells.
+uint32_t overlapVoxels(const VoxelModel& a, const glm::dmat4& aToWorld,
+                       const VoxelModel& b, const glm::dmat4& bToWorld,
+                       glm::dvec3* point = nullptr);
+
+// Finds overlapping entities of an EntityStore each tick.
+// The broadphase is sweep-and-prune on world-space boxes along x. The sorted
+// proxy list persists between updates and is re-sorted with an insertion
+// sort, which is close to linear when entities move a little each tick.
+// Candidate pairs then go through overlapVoxels.
+class CollisionSystem {
+public:
+    // Brings the world's matrices up to date (on the job system when given)
+    // and rebuilds the contact list
+    void update(EntityStore& world, JobSystem* jobs = nullptr);
+    void clear();
+
+    const std::vector<Contact>& getContacts() const { return contacts_; }
+    const CollisionStats& getStats() const { return stats_; }
+
+private:
+    struct Proxy {
+        EntityId id;
+        glm::dvec3 min, max;    // World-space box
+    };
+
+    std::vector<Proxy> proxies_;        // Sorted by min.x
+    std::vector<uint8_t> tracked_;      // Indexed by EntityId
+    std::vector<Contact> contacts_;
+    CollisionStats stats_;
+};
+
+} // namespace SpaceGame
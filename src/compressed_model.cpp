@@ -0,0 +1,288 @@
+#include "compressed_model.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace SpaceGame {
+
+namespace {
+
+const size_t MAX_MATERIALS = 0xFFFF;
+const size_t MATERIAL_SIZE = 8;     // type, health, r, g, b, a, 2 pad
+const size_t BRICK_SIZE = 12;       // x, y, z, runCount, firstRun
+const size_t RUN_SIZE = 4;          // value, length
+
+uint64_t materialKey(const Voxel& v) {
+    return ((uint64_t)v.type << 40) | ((uint64_t)v.health << 32) |
+           ((uint64_t)v.color.r << 24) | ((uint64_t)v.color.g << 16) |
+           ((uint64_t)v.color.b << 8) | (uint64_t)v.color.a;
+}
+
+bool brickLess(const CompressedVoxelModel::Brick& a, int16_t x, int16_t y, int16_t z) {
+    if (a.z != z) return a.z < z;
+    if (a.y != y) return a.y < y;
+    return a.x < x;
+}
+
+} // namespace
+
+CompressedVoxelModel::CompressedVoxelModel() : voxelCount_(0) {}
+
+void CompressedVoxelModel::clear() {
+    palette_.clear();
+    bricks_.clear();
+    runs_.clear();
+    voxelCount_ = 0;
+}
+
+bool CompressedVoxelModel::compress(const VoxelModel& model) {
+    clear();
+
+    const VoxelIndex& index = model.getIndex();
+    const std::vector<Voxel>& voxels = model.getVoxels();
+
+    // Visit bricks in (z, y, x) order so lookups can binary search
+    std::vector<const VoxelIndex::Brick*> order;
+    order.reserve(index.getBricks().size());
+    for (const VoxelIndex::Brick& brick : index.getBricks()) {
+        if (brick.count > 0) {
+            order.push_back(&brick);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const VoxelIndex::Brick* a, const VoxelIndex::Brick* b) {
+        if (a->z != b->z) return a->z < b->z;
+        if (a->y != b->y) return a->y < b->y;
+        return a->x < b->x;
+    });
+
+    std::unordered_map<uint64_t, uint16_t> materials;
+    bricks_.reserve(order.size());
+
+    for (const VoxelIndex::Brick* source : order) {
+        Brick brick;
+        brick.x = source->x;
+        brick.y = source->y;
+        brick.z = source->z;
+        brick.firstRun = (uint32_t)runs_.size();
+        brick.runCount = 0;
+
+        Run run = { 0, 0 };
+        for (int cell = 0; cell < VoxelIndex::BRICK_VOLUME; ++cell) {
+            uint16_t value = 0;
+            uint32_t slot = source->slots[cell];
+            if (slot != VoxelIndex::NONE) {
+                const Voxel& v = voxels[slot];
+                auto found = materials.find(materialKey(v));
+                if (found == materials.end()) {
+                    if (palette_.size() >= MAX_MATERIALS) {
+                        clear();
+                        return false;
+                    }
+                    palette_.push_back({ v.type, v.health, v.color });
+                    found = materials.emplace(materialKey(v), (uint16_t)palette_.size()).first;
+                }
+                value = found->second;
+                voxelCount_++;
+            }
+
+            if (run.length > 0 && run.value != value) {
+                runs_.push_back(run);
+                brick.runCount++;
+                run.length = 0;
+            }
+            run.value = value;
+            run.length++;
+        }
+        runs_.push_back(run);
+        brick.runCount++;
+
+        bricks_.push_back(brick);
+    }
+    return true;
+}
+
+void CompressedVoxelModel::decompress(VoxelModel& model) const {
+    std::vector<Voxel> voxels;
+    voxels.reserve(voxelCount_);
+
+    for (const Brick& brick : bricks_) {
+        int cell = 0;
+        for (uint32_t r = 0; r < brick.runCount; ++r) {
+            const Run& run = runs_[brick.firstRun + r];
+            if (run.value == 0) {
+                cell += run.length;
+                continue;
+            }
+
+            const Material& material = palette_[run.value - 1];
+            Voxel v;
+            v.type = material.type;
+            v.health = material.health;
+            v.color = material.color;
+            for (int end = cell + run.length; cell < end; ++cell) {
+                v.x = (int16_t)((brick.x << VoxelIndex::BRICK_SHIFT) | (cell & VoxelIndex::BRICK_MASK));
+                v.y = (int16_t)((brick.y << VoxelIndex::BRICK_SHIFT) | ((cell >> VoxelIndex::BRICK_SHIFT) & VoxelIndex::BRICK_MASK));
+                v.z = (int16_t)((brick.z << VoxelIndex::BRICK_SHIFT) | (cell >> (2 * VoxelIndex::BRICK_SHIFT)));
+                voxels.push_back(v);
+            }
+        }
+    }
+
+    model.setVoxels(std::move(voxels));
+}
+
+bool CompressedVoxelModel::getVoxel(int16_t x, int16_t y, int16_t z, Voxel& out) const {
+    int16_t bx = VoxelIndex::brickCoord(x);
+    int16_t by = VoxelIndex::brickCoord(y);
+    int16_t bz = VoxelIndex::brickCoord(z);
+
+    auto it = std::lower_bound(bricks_.begin(), bricks_.end(), 0, [&](const Brick& brick, int) {
+        return brickLess(brick, bx, by, bz);
+    });
+    if (it == bricks_.end() || it->x != bx || it->y != by || it->z != bz) {
+        return false;
+    }
+
+    int cell = VoxelIndex::cellIndex(x, y, z);
+    int start = 0;
+    for (uint32_t r = 0; r < it->runCount; ++r) {
+        const Run& run = runs_[it->firstRun + r];
+        if (cell < start + run.length) {
+            if (run.value == 0) {
+                return false;
+            }
+            const Material& material = palette_[run.value - 1];
+            out.x = x;
+            out.y = y;
+            out.z = z;
+            out.type = material.type;
+            out.health = material.health;
+            out.color = material.color;
+            return true;
+        }
+        start += run.length;
+    }
+    return false;
+}
+
+size_t CompressedVoxelModel::getMemoryUsage() const {
+    return palette_.capacity() * sizeof(Material) +
+           bricks_.capacity() * sizeof(Brick) +
+           runs_.capacity() * sizeof(Run);
+}
+
+void CompressedVoxelModel::serialize(std::vector<uint8_t>& out) const {
+    out.reserve(out.size() + 16 + palette_.size() * MATERIAL_SIZE +
+                bricks_.size() * BRICK_SIZE + runs_.size() * RUN_SIZE);
+
+    writeValue(out, (uint32_t)voxelCount_);
+    writeValue(out, (uint32_t)palette_.size());
+    writeValue(out, (uint32_t)bricks_.size());
+    writeValue(out, (uint32_t)runs_.size());
+
+    for (const Material& m : palette_) {
+        writeValue(out, m.type);
+        writeValue(out, m.health);
+        writeValue(out, m.color.r);
+        writeValue(out, m.color.g);
+        writeValue(out, m.color.b);
+        writeValue(out, m.color.a);
+        writeValue(out, (uint16_t)0);
+    }
+    for (const Brick& b : bricks_) {
+        writeValue(out, b.x);
+        writeValue(out, b.y);
+        writeValue(out, b.z);
+        writeValue(out, b.runCount);
+        writeValue(out, b.firstRun);
+    }
+    for (const Run& r : runs_) {
+        writeValue(out, r.value);
+        writeValue(out, r.length);
+    }
+}
+
+bool CompressedVoxelModel::deserialize(const uint8_t* data, size_t size, bool swapped) {
+    clear();
+    if (size < 16) {
+        return false;
+    }
+
+    auto read16 = [swapped](const uint8_t* p) {
+        uint16_t v = readValue<uint16_t>(p);
+        return swapped ? swap16(v) : v;
+    };
+    auto read32 = [swapped](const uint8_t* p) {
+        uint32_t v = readValue<uint32_t>(p);
+        return swapped ? swap32(v) : v;
+    };
+
+    uint64_t voxelCount = read32(data);
+    uint64_t paletteCount = read32(data + 4);
+    uint64_t brickCount = read32(data + 8);
+    uint64_t runCount = read32(data + 12);
+    if (paletteCount > MAX_MATERIALS ||
+        size != 16 + paletteCount * MATERIAL_SIZE + brickCount * BRICK_SIZE + runCount * RUN_SIZE) {
+        return false;
+    }
+
+    const uint8_t* p = data + 16;
+    palette_.resize(paletteCount);
+    for (Material& m : palette_) {
+        m.type = static_cast<VoxelType>(p[0]);
+        m.health = p[1];
+        m.color = Color(p[2], p[3], p[4], p[5]);
+        p += MATERIAL_SIZE;
+    }
+
+    bricks_.resize(brickCount);
+    for (Brick& b : bricks_) {
+        b.x = (int16_t)read16(p);
+        b.y = (int16_t)read16(p + 2);
+        b.z = (int16_t)read16(p + 4);
+        b.runCount = read16(p + 6);
+        b.firstRun = read32(p + 8);
+        p += BRICK_SIZE;
+    }
+
+    runs_.resize(runCount);
+    for (Run& r : runs_) {
+        r.value = read16(p);
+        r.length = read16(p + 2);
+        p += RUN_SIZE;
+    }
+
+    // Every brick must cover exactly its cells with valid palette indices
+    size_t counted = 0;
+    for (const Brick& b : bricks_) {
+        if ((uint64_t)b.firstRun + b.runCount > runs_.size()) {
+            clear();
+            return false;
+        }
+        int cells = 0;
+        for (uint32_t r = 0; r < b.runCount; ++r) {
+            const Run& run = runs_[b.firstRun + r];
+            if (run.value > palette_.size()) {
+                clear();
+                return false;
+            }
+            cells += run.length;
+            if (run.value != 0) {
+                counted += run.length;
+            }
+        }
+        if (cells != VoxelIndex::BRICK_VOLUME) {
+            clear();
+            return false;
+        }
+    }
+    if (counted != voxelCount) {
+        clear();
+        return false;
+    }
+
+    voxelCount_ = counted;
+    return true;
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// Read-only, palette and run-length encoded copy of a VoxelModel.
+// Every distinct (type, health, color) gets one palette entry and each 8x8x8
+// brick is stored as runs of palette indices in cell order, so a ship built
+// from a handful of materials costs a few bytes per run instead of 12 bytes
+// per voxel plus the brick index. Used to keep many ship designs resident and
+// as the payload of v3 model files.
+class CompressedVoxelModel {
+public:
+    // Palette entry; index 0 of a run means empty
+    struct Material {
+        VoxelType type;
+        uint8_t health;
+        Color color;
+    };
+
+    struct Run {
+        uint16_t value;     // Palette index + 1, or 0 for empty cells
+        uint16_t length;    // Cells covered, 1..BRICK_VOLUME
+    };
+
+    struct Brick {
+        int16_t x, y, z;    // Brick coordinate
+        uint16_t runCount;
+        uint32_t firstRun;  // Offset into runs_
+    };
+
+    CompressedVoxelModel();
+
+    // Encodes the model; returns false if it has more than 65535 materials
+    bool compress(const VoxelModel& model);
+    // Rebuilds a full VoxelModel, replacing its contents
+    void decompress(VoxelModel& model) const;
+
+    // Random access without decompressing; returns false for empty cells
+    bool getVoxel(int16_t x, int16_t y, int16_t z, Voxel& out) const;
+
+    void clear();
+    size_t getVoxelCount() const { return voxelCount_; }
+    const std::vector<Material>& getPalette() const { return palette_; }
+    const std::vector<Brick>& getBricks() const { return bricks_; }
+    const std::vector<Run>& getRuns() const { return runs_; }
+    size_t getMemoryUsage() const;
+
+    // File payload: counts, palette, bricks and runs in host byte order
+    void serialize(std::vector<uint8_t>& out) const;
+    // Parses a payload written by serialize, byte-swapping if swapped is set
+    bool deserialize(const uint8_t* data, size_t size, bool swapped);
+
+private:
+    std::vector<Material> palette_;
+    std::vector<Brick> bricks_;     // Sorted by (z, y, x) for lookup
+    std::vector<Run> runs_;
+    size_t voxelCount_;
+};
+
+} // namespace SpaceGame
@@ -1,108 +1,369 @@
-#include "src/voxel.h"
-#include <iostream>
+// Procedural ship generator. Builds Enterprise-style hulls from a handful of
+// primitive shapes, optionally scaled and varied by seed, and writes each
+// model to disk as soon as it is finished.
+//
+// Usage: create_ship [--size S] [--seed N] [--count N] [--threads N]
+//                    [--out FILE] [--compress]
+//   --size      scale factor for every dimension (default 1)
+//   --seed      first seed; 0 gives the reference ship (default 0)
+//   --count     number of variants, seeds seed..seed+count-1 (default 1)
+//   --threads   worker threads, 0 uses every core (default 0)
+//   --out       output file; with --count > 1 the seed is appended to the
+//               name, e.g. data/ship_12.bin (default data/ship.bin)
+//   --compress  write the compressed v3 format instead of v2
+
+#include "voxel.h"
+#include "compressed_model.h"
+#include "job_system.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace SpaceGame;
+
+namespace {
+
+// One primitive of a hull. Shapes are filled in order and a later shape
+// overwrites an earlier one where they overlap, as with addVoxel.
+struct Shape {
+    enum Kind { Cylinder, Box };
+    Kind kind;
+    VoxelType type;
+    Color color;
+
+    // Cylinder: extends along axis (1 = Y, 2 = Z) from start for length
+    // voxels, centred on (a, b) in the other two axes (x and the remaining one)
+    int axis;
+    int a, b;
+    double radius;
+    int start, length;
+    int capLength;          // Leading slices that use capType and capColor
+    VoxelType capType;
+    Color capColor;
+
+    // Box: inclusive bounds
+    int min[3], max[3];
+
+    int sliceCount() const { return kind == Cylinder ? length : max[2] - min[2] + 1; }
+};
+
+Shape makeCylinder(int axis, int a, int b, double radius, int start, int length, VoxelType type, Color color) {
+    Shape shape = {};
+    shape.kind = Shape::Cylinder;
+    shape.type = type;
+    shape.color = color;
+    shape.axis = axis;
+    shape.a = a;
+    shape.b = b;
+    shape.radius = radius;
+    shape.start = start;
+    shape.length = length;
+    return shape;
+}
+
+Shape makeBox(int x0, int y0, int z0, int x1, int y1, int z1, VoxelType type, Color color) {
+    Shape shape = {};
+    shape.kind = Shape::Box;
+    shape.type = type;
+    shape.color = color;
+    shape.min[0] = x0; shape.min[1] = y0; shape.min[2] = z0;
+    shape.max[0] = x1; shape.max[1] = y1; shape.max[2] = z1;
+    return shape;
+}
+
+// Appends one slice of the shape: a layer of a cylinder or one z of a box
+void fillSlice(const Shape& shape, int slice, std::vector<Voxel>& out) {
+    if (shape.kind == Shape::Box) {
+        int16_t z = (int16_t)(shape.min[2] + slice);
+        for (int y = shape.min[1]; y <= shape.max[1]; ++y) {
+            for (int x = shape.min[0]; x <= shape.max[0]; ++x) {
+                out.push_back({(int16_t)x, (int16_t)y, z, shape.type, shape.color});
+            }
+        }
+        return;
+    }
+
+    bool cap = slice < shape.capLength;
+    VoxelType type = cap ? shape.capType : shape.type;
+    Color color = cap ? shape.capColor : shape.color;
+    int16_t k = (int16_t)(shape.start + slice);
+
+    // Integer disc test instead of a sqrt per cell
+    int extent = (int)shape.radius;
+    double radius2 = shape.radius * shape.radius;
+    for (int v = -extent; v <= extent; ++v) {
+        for (int u = -extent; u <= extent; ++u) {
+            if (u * u + v * v > radius2) {
+                continue;
+            }
+            int16_t x = (int16_t)(shape.a + u);
+            int16_t other = (int16_t)(shape.b + v);
+            if (shape.axis == 2) {
+                out.push_back({x, other, k, type, color});
+            } else {
+                out.push_back({x, k, other, type, color});
+            }
+        }
+    }
+}
 
-void createEnterprise(SpaceGame::VoxelModel& model) {
-    using namespace SpaceGame;
+// Upper bound on the voxels one slice can produce, for reserving
+size_t sliceCapacity(const Shape& shape) {
+    if (shape.kind == Shape::Box) {
+        return (size_t)(shape.max[0] - shape.min[0] + 1) * (shape.max[1] - shape.min[1] + 1);
+    }
+    // Every cell centre within radius has its whole unit square within
+    // radius + 1, so the disc of that radius bounds the count
+    double reach = shape.radius + 1.0;
+    return (size_t)(3.14159266 * reach * reach) + 1;
+}
+
+struct ShipParams {
+    double size = 1.0;
+    uint32_t seed = 0;
+};
+
+// Enterprise-style layout. Seed 0 and size 1 reproduce the reference ship;
+// other seeds vary each proportion by up to 20% and tint the hull.
+std::vector<Shape> designShip(const ShipParams& params) {
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+    auto dim = [&](int base) {
+        double scale = params.size * (params.seed != 0 ? jitter(rng) : 1.0);
+        return std::max(1, (int)std::lround(base * scale));
+    };
 
     Color hullColor(200, 200, 210);
     Color detailColor(180, 180, 190);
     Color bussardColor(255, 100, 100);
     Color warpGrillColor(100, 200, 255);
     Color deflectorColor(120, 180, 255);
+    if (params.seed != 0) {
+        std::uniform_int_distribution<int> tint(-20, 20);
+        hullColor = Color((uint8_t)(200 + tint(rng)), (uint8_t)(200 + tint(rng)), (uint8_t)(210 + tint(rng)));
+    }
+
+    std::vector<Shape> shapes;
 
     // --- Saucer Section (Primary Hull) ---
-    int saucerRadius = 14;
-    int saucerHeight = 3;
-    for (int y = -saucerRadius; y <= saucerRadius; ++y) {
-        for (int x = -saucerRadius; x <= saucerRadius; ++x) {
-            if (std::sqrt(x*x + y*y) <= saucerRadius) {
-                for (int z = 0; z < saucerHeight; ++z) {
-                     model.addVoxel({(int16_t)x, (int16_t)y, (int16_t)z, VoxelType::Hull, hullColor});
-                }
-            }
-        }
-    }
+    int saucerRadius = dim(14);
+    int saucerHeight = dim(3);
+    shapes.push_back(makeCylinder(2, 0, 0, saucerRadius, 0, saucerHeight, VoxelType::Hull, hullColor));
     // Bridge
-    model.addVoxel({0, 0, (int16_t)saucerHeight, VoxelType::Hull, detailColor});
-    model.addVoxel({0, 1, (int16_t)saucerHeight, VoxelType::Hull, detailColor});
-
+    shapes.push_back(makeBox(0, 0, saucerHeight, 0, 1, saucerHeight, VoxelType::Hull, detailColor));
 
     // --- Neck ---
-    int neckHeight = 5;
-    for (int z = -neckHeight; z < 0; ++z) {
-        for (int y = -1; y <= 1; ++y) {
-            model.addVoxel({0, (int16_t)(y + saucerRadius - 2), (int16_t)z, VoxelType::Hull, detailColor});
-        }
-    }
+    int neckHeight = dim(5);
+    shapes.push_back(makeBox(0, saucerRadius - 3, -neckHeight, 0, saucerRadius - 1, -1, VoxelType::Hull, detailColor));
 
     // --- Secondary Hull ---
-    int secHullLength = 20;
-    int secHullRadius = 4;
+    int secHullLength = dim(20);
+    int secHullRadius = dim(4);
     int secHullOffsetY = saucerRadius + 2;
     int secHullOffsetZ = -neckHeight - secHullRadius;
-
-    for (int y = -secHullRadius; y <= secHullRadius; ++y) {
-        for (int x = -secHullRadius; x <= secHullRadius; ++x) {
-            if (std::sqrt(x*x + y*y) <= secHullRadius) {
-                for (int k = 0; k < secHullLength; ++k) {
-                    model.addVoxel({(int16_t)x, (int16_t)(k + secHullOffsetY), (int16_t)(y + secHullOffsetZ), VoxelType::Hull, hullColor});
-                }
-            }
-        }
-    }
+    shapes.push_back(makeCylinder(1, 0, secHullOffsetZ, secHullRadius, secHullOffsetY, secHullLength,
+                                  VoxelType::Hull, hullColor));
     // Deflector Dish
-    for (int y = -secHullRadius+1; y <= secHullRadius-1; ++y) {
-        for (int x = -secHullRadius+1; x <= secHullRadius-1; ++x) {
-             if (std::sqrt(x*x + y*y) <= secHullRadius-1) {
-                model.addVoxel({(int16_t)x, (int16_t)secHullOffsetY, (int16_t)(y + secHullOffsetZ), VoxelType::System, deflectorColor});
-             }
-        }
-    }
-
+    shapes.push_back(makeCylinder(1, 0, secHullOffsetZ, secHullRadius - 1, secHullOffsetY, 1,
+                                  VoxelType::System, deflectorColor));
 
     // --- Nacelle Pylons & Nacelles ---
-    int pylonLength = 12;
-    int nacelleLength = 18;
-    int nacelleRadius = 2;
-    int nacelleOffsetZ = -10;
+    int pylonLength = dim(12);
+    int nacelleLength = dim(18);
+    int nacelleRadius = dim(2);
+    int nacelleOffsetZ = -dim(10);
 
     for (int side = -1; side <= 1; side += 2) {
         // Pylons
         for (int i = 0; i < pylonLength; ++i) {
-             model.addVoxel({(int16_t)(side * (saucerRadius/2 + i/2)), (int16_t)(secHullOffsetY + secHullLength - pylonLength + i), (int16_t)(nacelleOffsetZ + i/3), VoxelType::Hull, detailColor});
+            int x = side * (saucerRadius / 2 + i / 2);
+            int y = secHullOffsetY + secHullLength - pylonLength + i;
+            int z = nacelleOffsetZ + i / 3;
+            shapes.push_back(makeBox(x, y, z, x, y, z, VoxelType::Hull, detailColor));
         }
 
-        // Nacelles
-        int nacelleOffsetX = side * (saucerRadius/2 + pylonLength/2);
+        // Nacelles, with the bussard collector as the leading slice
+        int nacelleOffsetX = side * (saucerRadius / 2 + pylonLength / 2);
         int nacelleOffsetY = secHullOffsetY + secHullLength;
+        int nacelleCenterZ = nacelleOffsetZ + pylonLength / 3;
+        Shape nacelle = makeCylinder(1, nacelleOffsetX, nacelleCenterZ, nacelleRadius, nacelleOffsetY, nacelleLength,
+                                     VoxelType::Engine, hullColor);
+        nacelle.capLength = 1;
+        nacelle.capType = VoxelType::System;
+        nacelle.capColor = bussardColor;
+        shapes.push_back(nacelle);
 
-        for (int y = -nacelleRadius; y <= nacelleRadius; ++y) {
-            for (int x = -nacelleRadius; x <= nacelleRadius; ++x) {
-                if (std::sqrt(x*x + y*y) <= nacelleRadius) {
-                    for (int k = 0; k < nacelleLength; k++) {
-                        Color c = (k == 0) ? bussardColor : hullColor;
-                        VoxelType t = (k==0) ? VoxelType::System : VoxelType::Engine;
-                         model.addVoxel({(int16_t)(x + nacelleOffsetX), (int16_t)(k + nacelleOffsetY), (int16_t)(y + nacelleOffsetZ + pylonLength/3), t, c});
-                    }
-                    // Warp Grills
-                    model.addVoxel({(int16_t)(x + nacelleOffsetX), (int16_t)(nacelleOffsetY + nacelleLength/2), (int16_t)(y + nacelleOffsetZ+ pylonLength/3), VoxelType::Thruster, warpGrillColor});
-                }
+        // Warp Grills
+        shapes.push_back(makeCylinder(1, nacelleOffsetX, nacelleCenterZ, nacelleRadius,
+                                      nacelleOffsetY + nacelleLength / 2, 1, VoxelType::Thruster, warpGrillColor));
+    }
+
+    return shapes;
+}
+
+// Fills every shape into model. Slices are filled in parallel when jobs is
+// given and concatenated in shape order, so overlaps resolve as in a serial
+// fill.
+void buildShip(const std::vector<Shape>& shapes, VoxelModel& model, JobSystem* jobs) {
+    struct Slice {
+        const Shape* shape;
+        int index;
+    };
+    std::vector<Slice> slices;
+    size_t capacity = 0;
+    for (const Shape& shape : shapes) {
+        for (int i = 0; i < shape.sliceCount(); ++i) {
+            slices.push_back({ &shape, i });
+        }
+        capacity += sliceCapacity(shape) * shape.sliceCount();
+    }
+
+    std::vector<Voxel> voxels;
+    voxels.reserve(capacity);
+
+    if (!jobs) {
+        for (const Slice& slice : slices) {
+            fillSlice(*slice.shape, slice.index, voxels);
+        }
+    } else {
+        std::vector<std::vector<Voxel>> filled(slices.size());
+        jobs->parallelFor(slices.size(), 4, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; ++i) {
+                filled[i].reserve(sliceCapacity(*slices[i].shape));
+                fillSlice(*slices[i].shape, slices[i].index, filled[i]);
             }
+        });
+        // Free each slice once copied so the two copies never coexist in full
+        for (std::vector<Voxel>& part : filled) {
+            voxels.insert(voxels.end(), part.begin(), part.end());
+            std::vector<Voxel>().swap(part);
         }
     }
+
+    // The reservation is an upper bound; the model keeps this buffer
+    voxels.shrink_to_fit();
+    model.setVoxels(std::move(voxels));
 }
 
+std::string outputPath(const std::string& base, uint32_t seed, bool numbered) {
+    if (!numbered) {
+        return base;
+    }
+    size_t dot = base.find_last_of('.');
+    size_t slash = base.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return base + "_" + std::to_string(seed);
+    }
+    return base.substr(0, dot) + "_" + std::to_string(seed) + base.substr(dot);
+}
 
-int main() {
-    SpaceGame::VoxelModel model;
-    createEnterprise(model);
+void printDetails(VoxelModel& model) {
+    size_t surfaceCount = model.getSurfaceVoxelCount();
+    MeshStats meshStats = model.getMeshStats();
+    MemoryFootprint footprint = model.getMemoryFootprint();
+    std::cout << model.getVoxels().size() << " voxels ("
+              << surfaceCount << " on the surface), "
+              << footprint.total() << " bytes (voxels " << footprint.voxels
+              << ", index " << footprint.index
+              << ", soa " << footprint.soa
+              << ", surface " << footprint.surface
+              << ", mesh " << footprint.mesh << ")" << std::endl;
+    std::cout << "Greedy mesh: " << meshStats.trianglesBefore() << " triangles before merging, "
+              << meshStats.trianglesAfter() << " after" << std::endl;
 
-    if (model.saveToFile("data/ship.bin")) {
-        std::cout << "Enterprise model saved successfully." << std::endl;
+    CompressedVoxelModel compressed;
+    if (compressed.compress(model)) {
+        std::cout << "Compressed: " << compressed.getMemoryUsage() << " bytes ("
+                  << compressed.getPalette().size() << " materials, "
+                  << compressed.getRuns().size() << " runs in "
+                  << compressed.getBricks().size() << " bricks)" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ShipParams params;
+    int count = 1;
+    int threadCount = 0;
+    std::string out = "data/ship.bin";
+    FileFormat format = FileFormat::V2;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            params.size = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            params.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--count") == 0 && hasValue) {
+            count = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            out = argv[++i];
+        } else if (std::strcmp(argv[i], "--compress") == 0) {
+            format = FileFormat::Compressed;
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // The largest reference dimension is ~60 voxels, keep it within int16
+    if (params.size <= 0.0 || params.size > 400.0 || count < 1) {
+        std::cerr << "--size must be in (0, 400] and --count at least 1" << std::endl;
+        return 1;
+    }
+
+    JobSystem jobs(threadCount);
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> totalVoxels(0);
+    std::atomic<int> failures(0);
+
+    auto generate = [&](uint32_t seed, VoxelModel& model, JobSystem* sliceJobs) {
+        ShipParams variant = params;
+        variant.seed = seed;
+        buildShip(designShip(variant), model, sliceJobs);
+        totalVoxels += model.getVoxels().size();
+
+        std::string path = outputPath(out, seed, count > 1);
+        if (!model.saveToFile(path.c_str(), format)) {
+            std::cerr << "Error saving " << path << std::endl;
+            failures++;
+        }
+    };
+
+    if (count == 1 || count < jobs.getThreadCount()) {
+        // Few large models: parallelise the fill of each one
+        VoxelModel model;
+        for (int i = 0; i < count; ++i) {
+            generate(params.seed + (uint32_t)i, model, &jobs);
+            if (count == 1) {
+                printDetails(model);
+            }
+        }
     } else {
-        std::cerr << "Error saving Enterprise model." << std::endl;
+        // Many models: one per job, each written and freed before the next
+        // so only one model per thread is ever held in memory
+        jobs.parallelFor((size_t)count, 1, [&](size_t begin, size_t end, int) {
+            VoxelModel model;
+            for (size_t i = begin; i < end; ++i) {
+                generate(params.seed + (uint32_t)i, model, nullptr);
+            }
+        });
     }
 
-    return 0;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << count << (count == 1 ? " model, " : " models, ") << totalVoxels.load() << " voxels in "
+              << seconds * 1000.0 << " ms on " << jobs.getThreadCount() << " threads: "
+              << totalVoxels.load() / seconds << " voxels/s including writes" << std::endl;
+
+    return failures > 0 ? 1 : 0;
 }
@@ -1,22 +1,37 @@
 #include "entity.h"
+#include <cmath>
 
 namespace SpaceGame {
 
+glm::dmat4 composeModelMatrix(const glm::dvec3& position, const glm::dvec3& rotation, const glm::dvec3& scale) {
+    const double cx = std::cos(rotation.x), sx = std::sin(rotation.x);
+    const double cy = std::cos(rotation.y), sy = std::sin(rotation.y);
+    const double cz = std::cos(rotation.z), sz = std::sin(rotation.z);
+
+    // Columns of Rx * Ry * Rz, each multiplied by its scale component
+    glm::dmat4 model(1.0);
+    model[0] = glm::dvec4(cy * cz, sx * sy * cz + cx * sz, sx * sz - cx * sy * cz, 0.0) * scale.x;
+    model[1] = glm::dvec4(-cy * sz, cx * cz - sx * sy * sz, cx * sy * sz + sx * cz, 0.0) * scale.y;
+    model[2] = glm::dvec4(sy, -sx * cy, cx * cy, 0.0) * scale.z;
+    model[3] = glm::dvec4(position, 1.0);
+    return model;
+}
+
 Entity::Entity()
     : position_(0, 0, 0),
       rotation_(0, 0, 0),
-      scale_(1, 1, 1) {}
+      scale_(1, 1, 1),
+      modelMatrix_(1.0),
+      matrixDirty_(true) {}
 
 Entity::~Entity() {}
 
-glm::dmat4 Entity::getModelMatrix() const {
-    glm::dmat4 model = glm::dmat4(1.0);
-    model = glm::translate(model, position_);
-    model = glm::rotate(model, rotation_.x, glm::dvec3(1, 0, 0));
-    model = glm::rotate(model, rotation_.y, glm::dvec3(0, 1, 0));
-    model = glm::rotate(model, rotation_.z, glm::dvec3(0, 0, 1));
-    model = glm::scale(model, scale_);
-    return model;
+const glm::dmat4& Entity::getModelMatrix() const {
+    if (matrixDirty_) {
+        modelMatrix_ = composeModelMatrix(position_, rotation_, scale_);
+        matrixDirty_ = false;
+    }
+    return modelMatrix_;
 }
 
 void Entity::update(double deltaTime) {
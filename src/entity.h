@@ -6,21 +6,26 @@
 
 namespace SpaceGame {
 
+// Translation * rotateX * rotateY * rotateZ * scale, built in closed form
+// rather than through three glm::rotate calls
+glm::dmat4 composeModelMatrix(const glm::dvec3& position, const glm::dvec3& rotation, const glm::dvec3& scale);
+
 class Entity {
 public:
     Entity();
     virtual ~Entity();
 
-    void setPosition(const glm::dvec3& pos) { position_ = pos; }
+    void setPosition(const glm::dvec3& pos) { position_ = pos; matrixDirty_ = true; }
     const glm::dvec3& getPosition() const { return position_; }
 
-    void setRotation(const glm::dvec3& rot) { rotation_ = rot; }
+    void setRotation(const glm::dvec3& rot) { rotation_ = rot; matrixDirty_ = true; }
     const glm::dvec3& getRotation() const { return rotation_; }
 
-    void setScale(const glm::dvec3& scale) { scale_ = scale; }
+    void setScale(const glm::dvec3& scale) { scale_ = scale; matrixDirty_ = true; }
     const glm::dvec3& getScale() const { return scale_; }
 
-    glm::dmat4 getModelMatrix() const;
+    // Cached; rebuilt on the first call after a transform setter
+    const glm::dmat4& getModelMatrix() const;
 
     virtual void update(double deltaTime);
     virtual void draw();
@@ -29,6 +34,10 @@ protected:
     glm::dvec3 position_;
     glm::dvec3 rotation_;
     glm::dvec3 scale_;
+
+private:
+    mutable glm::dmat4 modelMatrix_;
+    mutable bool matrixDirty_;
 };
 
 } // namespace SpaceGame
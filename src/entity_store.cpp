@@ -0,0 +1,170 @@
+#include "entity_store.h"
+#include "entity.h"
+
+namespace SpaceGame {
+
+EntityStore::EntityStore() {}
+
+EntityId EntityStore::create(ModelRef model, const glm::dvec3& position,
+                             const glm::dvec3& rotation, const glm::dvec3& scale) {
+    EntityId id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else {
+        id = (EntityId)idToIndex_.size();
+        idToIndex_.push_back(INVALID);
+    }
+    idToIndex_[id] = (uint32_t)ids_.size();
+
+    ids_.push_back(id);
+    positions_.push_back(position);
+    rotations_.push_back(rotation);
+    scales_.push_back(scale);
+    velocities_.push_back(glm::dvec3(0.0));
+    angularVelocities_.push_back(glm::dvec3(0.0));
+    models_.push_back(std::move(model));
+    matrices_.push_back(glm::dmat4(1.0));
+    dirty_.push_back(1);
+    return id;
+}
+
+void EntityStore::destroy(EntityId id) {
+    if (!isAlive(id)) {
+        return;
+    }
+
+    // Move the last entity into the freed slot
+    uint32_t index = idToIndex_[id];
+    uint32_t last = (uint32_t)ids_.size() - 1;
+    if (index != last) {
+        ids_[index] = ids_[last];
+        positions_[index] = positions_[last];
+        rotations_[index] = rotations_[last];
+        scales_[index] = scales_[last];
+        velocities_[index] = velocities_[last];
+        angularVelocities_[index] = angularVelocities_[last];
+        models_[index] = models_[last];
+        matrices_[index] = matrices_[last];
+        dirty_[index] = dirty_[last];
+        idToIndex_[ids_[index]] = index;
+    }
+
+    ids_.pop_back();
+    positions_.pop_back();
+    rotations_.pop_back();
+    scales_.pop_back();
+    velocities_.pop_back();
+    angularVelocities_.pop_back();
+    models_.pop_back();
+    matrices_.pop_back();
+    dirty_.pop_back();
+
+    idToIndex_[id] = INVALID;
+    freeIds_.push_back(id);
+}
+
+bool EntityStore::isAlive(EntityId id) const {
+    return id < idToIndex_.size() && idToIndex_[id] != INVALID;
+}
+
+void EntityStore::clear() {
+    ids_.clear();
+    positions_.clear();
+    rotations_.clear();
+    scales_.clear();
+    velocities_.clear();
+    angularVelocities_.clear();
+    models_.clear();
+    matrices_.clear();
+    dirty_.clear();
+    idToIndex_.clear();
+    freeIds_.clear();
+}
+
+void EntityStore::reserve(size_t count) {
+    ids_.reserve(count);
+    positions_.reserve(count);
+    rotations_.reserve(count);
+    scales_.reserve(count);
+    velocities_.reserve(count);
+    angularVelocities_.reserve(count);
+    models_.reserve(count);
+    matrices_.reserve(count);
+    dirty_.reserve(count);
+    idToIndex_.reserve(count);
+}
+
+void EntityStore::setPosition(EntityId id, const glm::dvec3& position) {
+    uint32_t index = idToIndex_[id];
+    positions_[index] = position;
+    dirty_[index] = 1;
+}
+
+void EntityStore::setRotation(EntityId id, const glm::dvec3& rotation) {
+    uint32_t index = idToIndex_[id];
+    rotations_[index] = rotation;
+    dirty_[index] = 1;
+}
+
+void EntityStore::setScale(EntityId id, const glm::dvec3& scale) {
+    uint32_t index = idToIndex_[id];
+    scales_[index] = scale;
+    dirty_[index] = 1;
+}
+
+void EntityStore::setVelocity(EntityId id, const glm::dvec3& velocity) {
+    velocities_[idToIndex_[id]] = velocity;
+}
+
+void EntityStore::setAngularVelocity(EntityId id, const glm::dvec3& angularVelocity) {
+    angularVelocities_[idToIndex_[id]] = angularVelocity;
+}
+
+void EntityStore::setModel(EntityId id, ModelRef model) {
+    models_[idToIndex_[id]] = std::move(model);
+}
+
+void EntityStore::replaceModel(const VoxelModel* from, const ModelRef& to) {
+    for (ModelRef& model : models_) {
+        if (model.get() == from) {
+            model = to;
+        }
+    }
+}
+
+void EntityStore::integrate(double deltaTime) {
+    const size_t count = ids_.size();
+    for (size_t i = 0; i < count; ++i) {
+        const glm::dvec3& velocity = velocities_[i];
+        const glm::dvec3& angularVelocity = angularVelocities_[i];
+        if (velocity == glm::dvec3(0.0) && angularVelocity == glm::dvec3(0.0)) {
+            continue;
+        }
+        positions_[i] += velocity * deltaTime;
+        rotations_[i] += angularVelocity * deltaTime;
+        dirty_[i] = 1;
+    }
+}
+
+void EntityStore::updateMatrices(JobSystem* jobs) {
+    auto updateRange = [this](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) {
+            if (dirty_[i]) {
+                matrices_[i] = composeModelMatrix(positions_[i], rotations_[i], scales_[i]);
+                dirty_[i] = 0;
+            }
+        }
+    };
+
+    // A matrix costs a few hundred nanoseconds, so small stores are not
+    // worth waking the workers for
+    const size_t entitiesPerJob = 1024;
+    if (jobs && ids_.size() > entitiesPerJob) {
+        jobs->parallelFor(ids_.size(), entitiesPerJob, updateRange);
+    } else {
+        updateRange(0, ids_.size(), 0);
+    }
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include "job_system.h"
+#include "voxel.h"
+
+namespace SpaceGame {
+
+using EntityId = uint32_t;
+
+// Entities share ownership of their models, so a model swapped out by a
+// reload stays alive until no store, snapshot or frame refers to it
+using ModelRef = std::shared_ptr<const VoxelModel>;
+
+// Reference to a model the caller owns and keeps alive for as long as any
+// entity uses it, e.g. one on the stack
+inline ModelRef borrowModel(const VoxelModel& model) {
+    return ModelRef(ModelRef(), &model);
+}
+
+// Data-oriented alternative to a vector of Entity objects. Each component
+// lives in its own contiguous array and systems sweep those arrays without
+// virtual dispatch. Entities are addressed by a stable EntityId; destroying
+// one swap-removes it, so the dense order changes but ids stay valid.
+class EntityStore {
+public:
+    static constexpr EntityId INVALID = 0xFFFFFFFFu;
+
+    EntityStore();
+
+    EntityId create(ModelRef model, const glm::dvec3& position,
+                    const glm::dvec3& rotation = glm::dvec3(0.0),
+                    const glm::dvec3& scale = glm::dvec3(1.0));
+    void destroy(EntityId id);
+    bool isAlive(EntityId id) const;
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return positions_.size(); }
+    // Dense slot of a live entity, for indexing the array accessors
+    uint32_t indexOf(EntityId id) const { return idToIndex_[id]; }
+
+    void setPosition(EntityId id, const glm::dvec3& position);
+    void setRotation(EntityId id, const glm::dvec3& rotation);
+    void setScale(EntityId id, const glm::dvec3& scale);
+    void setVelocity(EntityId id, const glm::dvec3& velocity);
+    void setAngularVelocity(EntityId id, const glm::dvec3& angularVelocity);
+    void setModel(EntityId id, ModelRef model);
+    // Points every entity using one model at another, e.g. when a
+    // placeholder's real model arrives or a model is reloaded
+    void replaceModel(const VoxelModel* from, const ModelRef& to);
+
+    // Systems. integrate advances positions and rotations by their
+    // velocities; updateMatrices rebuilds only the matrices of entities moved
+    // since the last call, split across the job system when one is given.
+    void integrate(double deltaTime);
+    void updateMatrices(JobSystem* jobs = nullptr);
+
+    // Dense component arrays, all indexed by the same slot
+    const std::vector<EntityId>& getIds() const { return ids_; }
+    const std::vector<glm::dvec3>& getPositions() const { return positions_; }
+    const std::vector<glm::dvec3>& getRotations() const { return rotations_; }
+    const std::vector<glm::dvec3>& getScales() const { return scales_; }
+    const std::vector<ModelRef>& getModels() const { return models_; }
+    // Current after updateMatrices; contiguous, so runs of one model can go
+    // straight to Renderer::drawShips
+    const std::vector<glm::dmat4>& getMatrices() const { return matrices_; }
+
+private:
+    std::vector<EntityId> ids_;
+    std::vector<glm::dvec3> positions_;
+    std::vector<glm::dvec3> rotations_;
+    std::vector<glm::dvec3> scales_;
+    std::vector<glm::dvec3> velocities_;
+    std::vector<glm::dvec3> angularVelocities_;
+    std::vector<ModelRef> models_;
+    std::vector<glm::dmat4> matrices_;
+    std::vector<uint8_t> dirty_;
+
+    std::vector<uint32_t> idToIndex_;   // INVALID for destroyed ids
+    std::vector<EntityId> freeIds_;
+};
+
+} // namespace SpaceGame
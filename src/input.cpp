@@ -0,0 +1,99 @@
+#include "input.h"
+#include <algorithm>
+#include <cmath>
+
+namespace SpaceGame {
+
+Input::Input()
+    : keys_(nullptr), keyCount_(0), latencySamples_(0), latencySumMs_(0.0), latencyMaxMs_(0.0) {}
+
+void Input::handleEvent(const SDL_Event& event) {
+    if (event.type != SDL_EVENT_KEY_DOWN && event.type != SDL_EVENT_KEY_UP) {
+        return;
+    }
+    buffered_.push_back({ event.key.timestamp, event.key.scancode, event.key.down, event.key.repeat });
+}
+
+void Input::sample() {
+    // The array SDL returns stays valid and is updated as events are pumped
+    keys_ = SDL_GetKeyboardState(&keyCount_);
+
+    events_.swap(buffered_);
+    buffered_.clear();
+    for (const InputEvent& event : events_) {
+        if (event.down && !event.repeat) {
+            unpresented_.push_back(event.timestampNs);
+        }
+    }
+}
+
+bool Input::isHeld(SDL_Scancode scancode) const {
+    return keys_ && (int)scancode < keyCount_ && keys_[scancode];
+}
+
+bool Input::wasPressed(SDL_Scancode scancode) const {
+    for (const InputEvent& event : events_) {
+        if (event.scancode == scancode && event.down && !event.repeat) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Input::markPresented(uint64_t presentNs) {
+    for (uint64_t pressNs : unpresented_) {
+        double ms = presentNs > pressNs ? (presentNs - pressNs) * 1e-6 : 0.0;
+        latencySamples_++;
+        latencySumMs_ += ms;
+        latencyMaxMs_ = std::max(latencyMaxMs_, ms);
+    }
+    unpresented_.clear();
+}
+
+InputLatencyStats Input::getLatency() const {
+    InputLatencyStats stats;
+    stats.samples = latencySamples_;
+    stats.averageMs = latencySamples_ > 0 ? latencySumMs_ / latencySamples_ : 0.0;
+    stats.maxMs = latencyMaxMs_;
+    return stats;
+}
+
+void Input::resetLatency() {
+    latencySamples_ = 0;
+    latencySumMs_ = 0.0;
+    latencyMaxMs_ = 0.0;
+}
+
+CameraController::CameraController()
+    : velocity_(0.0), angularVelocity_(0.0), maxSpeed_(10.0), turnRate_(1.0), response_(0.08) {}
+
+void CameraController::update(Camera& camera, const Input& input, double seconds) {
+    if (seconds <= 0.0) {
+        return;
+    }
+    auto axis = [&input](SDL_Scancode positive, SDL_Scancode negative) {
+        return (input.isHeld(positive) ? 1.0 : 0.0) - (input.isHeld(negative) ? 1.0 : 0.0);
+    };
+
+    glm::dvec3 targetVelocity(axis(SDL_SCANCODE_D, SDL_SCANCODE_A), 0.0, axis(SDL_SCANCODE_W, SDL_SCANCODE_S));
+    glm::dvec3 targetAngular(axis(SDL_SCANCODE_UP, SDL_SCANCODE_DOWN), axis(SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT), 0.0);
+    targetVelocity *= maxSpeed_;
+    targetAngular *= turnRate_;
+
+    // Exact for any step length, so the feel does not depend on frame rate
+    double blend = response_ > 0.0 ? 1.0 - std::exp(-seconds / response_) : 1.0;
+    velocity_ += (targetVelocity - velocity_) * blend;
+    angularVelocity_ += (targetAngular - angularVelocity_) * blend;
+
+    camera.moveRight(velocity_.x * seconds);
+    camera.moveUp(velocity_.y * seconds);
+    camera.moveForward(velocity_.z * seconds);
+    camera.rotate(angularVelocity_.x * seconds, angularVelocity_.y * seconds, angularVelocity_.z * seconds);
+}
+
+void CameraController::stop() {
+    velocity_ = glm::dvec3(0.0);
+    angularVelocity_ = glm::dvec3(0.0);
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <vector>
+#include <glm/vec3.hpp>
+#include "camera.h"
+
+namespace SpaceGame {
+
+// A keyboard event as it left the SDL queue
+struct InputEvent {
+    uint64_t timestampNs;   // SDL_GetTicksNS clock, stamped when the OS delivered it
+    SDL_Scancode scancode;
+    bool down;
+    bool repeat;
+};
+
+// Time from a key press to the first present that could show its effect
+struct InputLatencyStats {
+    uint32_t samples = 0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+};
+
+// Keyboard input decoupled from OS key repeat. Events are buffered with their
+// timestamps as they are polled; sample() then reads the held keys once from
+// SDL_GetKeyboardState, so continuous actions follow the sampling rate rather
+// than the repeat rate and its initial delay. Presses are kept as events, so
+// a tap shorter than one sample is not lost.
+class Input {
+public:
+    Input();
+
+    // Buffers keyboard events; anything else is ignored
+    void handleEvent(const SDL_Event& event);
+
+    // Reads the keyboard state and makes the buffered events current. Call
+    // once per tick, after the event queue has been drained.
+    void sample();
+
+    bool isHeld(SDL_Scancode scancode) const;
+    // Pressed since the previous sample, ignoring key repeat
+    bool wasPressed(SDL_Scancode scancode) const;
+    // Events taken by the last sample, oldest first
+    const std::vector<InputEvent>& getEvents() const { return events_; }
+
+    // Call right after presenting a frame. Every press taken by a sample
+    // since the previous present counts as shown by this one.
+    void markPresented(uint64_t presentNs);
+    // Latency since the last reset
+    InputLatencyStats getLatency() const;
+    void resetLatency();
+
+private:
+    std::vector<InputEvent> buffered_;  // Polled, waiting for the next sample
+    std::vector<InputEvent> events_;    // Taken by the last sample
+    std::vector<uint64_t> unpresented_; // Press times not yet presented
+    const bool* keys_;
+    int keyCount_;
+
+    uint32_t latencySamples_;
+    double latencySumMs_;
+    double latencyMaxMs_;
+};
+
+// Flies a camera from held keys. Key input sets a target velocity in camera
+// space that the actual velocity approaches exponentially, and the camera
+// moves by the integrated velocity, so motion is smooth and independent of
+// how often input is sampled.
+class CameraController {
+public:
+    CameraController();
+
+    void setMaxSpeed(double unitsPerSecond) { maxSpeed_ = unitsPerSecond; }
+    void setTurnRate(double radiansPerSecond) { turnRate_ = radiansPerSecond; }
+    // Seconds to close most (63%) of the gap to the target velocity
+    void setResponse(double seconds) { response_ = seconds; }
+
+    void update(Camera& camera, const Input& input, double seconds);
+    void stop();
+
+    // x right, y up, z forward
+    const glm::dvec3& getVelocity() const { return velocity_; }
+
+private:
+    glm::dvec3 velocity_;
+    glm::dvec3 angularVelocity_;    // Pitch, yaw, roll rates
+    double maxSpeed_;
+    double turnRate_;
+    double response_;
+};
+
+} // namespace SpaceGame
@@ -0,0 +1,137 @@
+#include "job_system.h"
+#include <algorithm>
+#include <chrono>
+
+namespace SpaceGame {
+
+JobSystem::JobSystem(int threadCount) : pendingJobs_(0), stopping_(false) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Worker 0 is whichever thread calls parallelFor
+    for (int i = 1; i < threadCount; ++i) {
+        workers_[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize, const RangeFunction& fn,
+                            std::vector<double>* threadTimes) {
+    // Callers take turns being worker 0, so per-worker buffers indexed by
+    // the worker argument are never shared between two batches
+    std::lock_guard<std::mutex> caller(callerMutex_);
+
+    if (threadTimes) {
+        threadTimes->assign(workers_.size(), 0.0);
+    }
+    if (count == 0) {
+        return;
+    }
+
+    grainSize = std::max<size_t>(grainSize, 1);
+    size_t jobCount = (count + grainSize - 1) / grainSize;
+
+    Batch batch;
+    batch.fn = &fn;
+    batch.remaining = jobCount;
+    batch.busyNs.assign(workers_.size(), 0);
+
+    // Count the jobs before publishing them so pendingJobs_ never underflows
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        pendingJobs_ += jobCount;
+    }
+
+    // Deal the chunks out round-robin so every worker starts with local work
+    for (size_t i = 0; i < jobCount; ++i) {
+        Worker& worker = *workers_[i % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back({ &batch, i * grainSize, std::min(count, (i + 1) * grainSize) });
+    }
+    wakeCondition_.notify_all();
+
+    Job job;
+    while (batch.remaining.load(std::memory_order_acquire) > 0) {
+        if (popJob(0, job)) {
+            runJob(job, 0);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (threadTimes) {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            (*threadTimes)[i] = batch.busyNs[i] / 1e6;
+        }
+    }
+}
+
+void JobSystem::workerLoop(int index) {
+    Job job;
+    while (true) {
+        if (popJob(index, job)) {
+            runJob(job, index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCondition_.wait(lock, [this] { return stopping_ || pendingJobs_.load() > 0; });
+        if (stopping_) {
+            return;
+        }
+    }
+}
+
+bool JobSystem::popJob(int index, Job& job) {
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            pendingJobs_--;
+            return true;
+        }
+    }
+
+    // Steal the oldest job of the next worker that has one
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(index + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            pendingJobs_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::runJob(const Job& job, int index) {
+    auto start = std::chrono::steady_clock::now();
+    (*job.batch->fn)(job.begin, job.end, index);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    job.batch->busyNs[index] += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    job.batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+} // namespace SpaceGame
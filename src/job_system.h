@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SpaceGame {
+
+// Fixed pool of worker threads, each with its own job deque. A worker pops
+// from the back of its own deque and, when that runs dry, steals from the
+// front of the others. The thread calling parallelFor joins in as worker 0.
+class JobSystem {
+public:
+    // fn(begin, end, worker) processes the index range [begin, end)
+    using RangeFunction = std::function<void(size_t, size_t, int)>;
+
+    // threadCount includes the calling thread; 0 uses every hardware thread
+    explicit JobSystem(int threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int getThreadCount() const { return (int)workers_.size(); }
+
+    // Splits [0, count) into chunks of at most grainSize and blocks until all
+    // of them have run. When threadTimes is given it receives the busy time
+    // of each worker in milliseconds. Calls from several threads are
+    // serialised, each caller running as worker 0 while it holds the pool.
+    // Must not be called from inside a job.
+    void parallelFor(size_t count, size_t grainSize, const RangeFunction& fn,
+                     std::vector<double>* threadTimes = nullptr);
+
+private:
+    struct Batch {
+        const RangeFunction* fn;
+        std::atomic<size_t> remaining;
+        std::vector<uint64_t> busyNs;   // Each worker writes only its own entry
+    };
+
+    struct Job {
+        Batch* batch;
+        size_t begin, end;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::thread thread;
+    };
+
+    void workerLoop(int index);
+    bool popJob(int index, Job& job);
+    void runJob(const Job& job, int index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex callerMutex_;    // Held for the whole of each parallelFor
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
+    std::atomic<size_t> pendingJobs_;
+    bool stopping_;
+};
+
+} // namespace SpaceGame
@@ -0,0 +1,124 @@
+#include "lod.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <unordered_map>
+
+namespace SpaceGame {
+
+namespace {
+
+// Sums over the children of one coarse voxel
+struct Block {
+    int16_t x, y, z;
+    uint32_t r = 0, g = 0, b = 0, a = 0;
+    uint32_t health = 0;
+    uint32_t count = 0;
+    VoxelType types[8];
+};
+
+uint64_t packCoord(int16_t x, int16_t y, int16_t z) {
+    return ((uint64_t)(uint16_t)x << 32) | ((uint64_t)(uint16_t)y << 16) | (uint64_t)(uint16_t)z;
+}
+
+// Ties go to the lowest type so the result does not depend on the order the
+// children were visited in
+VoxelType mostCommonType(const Block& block) {
+    VoxelType best = block.types[0];
+    uint32_t bestCount = 0;
+    for (uint32_t i = 0; i < block.count; ++i) {
+        uint32_t matches = 0;
+        for (uint32_t j = 0; j < block.count; ++j) {
+            matches += block.types[j] == block.types[i];
+        }
+        if (matches > bestCount || (matches == bestCount && block.types[i] < best)) {
+            best = block.types[i];
+            bestCount = matches;
+        }
+    }
+    return best;
+}
+
+void accumulate(Block& block, const Voxel& v) {
+    block.r += v.color.r;
+    block.g += v.color.g;
+    block.b += v.color.b;
+    block.a += v.color.a;
+    block.health += v.health;
+    block.types[block.count++] = v.type;
+}
+
+Voxel mergeBlock(const Block& block) {
+    uint32_t half = block.count / 2;
+    Voxel v(block.x, block.y, block.z, mostCommonType(block),
+            Color((uint8_t)((block.r + half) / block.count),
+                  (uint8_t)((block.g + half) / block.count),
+                  (uint8_t)((block.b + half) / block.count),
+                  (uint8_t)((block.a + half) / block.count)));
+    v.health = (uint8_t)((block.health + half) / block.count);
+    return v;
+}
+
+} // namespace
+
+void downsample(const VoxelModel& source, VoxelModel& out) {
+    const std::vector<Voxel>& voxels = source.getVoxels();
+
+    std::unordered_map<uint64_t, uint32_t> slots;
+    slots.reserve(voxels.size() / 4);
+    std::vector<Block> blocks;
+    blocks.reserve(voxels.size() / 4);
+
+    for (const Voxel& v : voxels) {
+        // Arithmetic shift rounds toward negative infinity, so -1 and 0 land
+        // in different blocks as they should
+        int16_t cx = (int16_t)(v.x >> 1);
+        int16_t cy = (int16_t)(v.y >> 1);
+        int16_t cz = (int16_t)(v.z >> 1);
+
+        auto inserted = slots.emplace(packCoord(cx, cy, cz), (uint32_t)blocks.size());
+        if (inserted.second) {
+            Block block;
+            block.x = cx;
+            block.y = cy;
+            block.z = cz;
+            blocks.push_back(block);
+        }
+
+        accumulate(blocks[inserted.first->second], v);
+    }
+
+    std::vector<Voxel> merged;
+    merged.reserve(blocks.size());
+    for (const Block& block : blocks) {
+        merged.push_back(mergeBlock(block));
+    }
+
+    out.setVoxels(std::move(merged));
+}
+
+bool downsampleBlock(const VoxelModel& source, int16_t x, int16_t y, int16_t z, Voxel& out) {
+    Block block;
+    block.x = x;
+    block.y = y;
+    block.z = z;
+    for (int child = 0; child < 8; ++child) {
+        const Voxel* v = source.getVoxel((int16_t)(2 * x + (child & 1)),
+                                         (int16_t)(2 * y + ((child >> 1) & 1)),
+                                         (int16_t)(2 * z + (child >> 2)));
+        if (v) {
+            accumulate(block, *v);
+        }
+    }
+    if (block.count == 0) {
+        return false;
+    }
+    out = mergeBlock(block);
+    return true;
+}
+
+glm::dmat4 lodToModel(int level) {
+    double scale = (double)(1 << level);
+    glm::dmat4 transform = glm::translate(glm::dmat4(1.0), glm::dvec3((scale - 1.0) * 0.5));
+    return glm::scale(transform, glm::dvec3(scale));
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// Builds the next level of a model's detail chain. Every occupied 2x2x2 block
+// of source becomes one voxel of out, at the block coordinate divided by two,
+// with the children's average color and health and their most common type.
+void downsample(const VoxelModel& source, VoxelModel& out);
+
+// Recomputes the single voxel of the next level at (x, y, z) from its eight
+// children in source, exactly as downsample would. Returns false when none
+// of the children exist.
+bool downsampleBlock(const VoxelModel& source, int16_t x, int16_t y, int16_t z, Voxel& out);
+
+// Maps voxel coordinates of detail level `level` into level 0 model space:
+// a level voxel spans 2^level source voxels and sits at their centre
+glm::dmat4 lodToModel(int level);
+
+} // namespace SpaceGame
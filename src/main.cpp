@@ -1,14 +1,62 @@
 #include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include "renderer.h"
 #include "camera.h"
+#include "input.h"
 #include "voxel.h"
-#include "ship.h"
+#include "entity_store.h"
+#include "simulation.h"
+#include "collision.h"
+#include "model_cache.h"
+#include "profiler.h"
+#include "job_system.h"
 
 int main(int argc, char* argv[]) {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS) != 0) {
+    // --threads N sets the projection thread count, 0 uses every core
+    // --fleet N adds N spinning copies of the ship beyond the player
+    // --sim-thread runs the simulation on its own thread
+    // --profile-csv FILE and --profile-trace FILE record every frame's
+    // profiler scopes and counters as CSV or Chrome trace JSON
+    // --watch reloads data/ship.bin whenever the file changes
+    // --tiled starts on the CPU tile rasteriser; B switches backends
+    int threadCount = 0;
+    int fleetSize = 0;
+    bool simThread = false;
+    const char* profileCsv = nullptr;
+    const char* profileTrace = nullptr;
+    bool watch = false;
+    bool tiled = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fleet") == 0 && i + 1 < argc) {
+            fleetSize = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--sim-thread") == 0) {
+            simThread = true;
+        } else if (std::strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            profileCsv = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            profileTrace = argv[++i];
+        } else if (std::strcmp(argv[i], "--watch") == 0) {
+            watch = true;
+        } else if (std::strcmp(argv[i], "--tiled") == 0) {
+            tiled = true;
+        }
+    }
+
+    // SDL3 reports success as true
+    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS)) {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
         std::cerr << "Platform: " << SDL_GetPlatform() << std::endl;
         return 1;
@@ -21,7 +69,19 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    SpaceGame::Profiler profiler;
+    if (profileCsv && !profiler.openCsv(profileCsv)) {
+        std::cerr << "Cannot write " << profileCsv << std::endl;
+    }
+    if (profileTrace && !profiler.openTrace(profileTrace)) {
+        std::cerr << "Cannot write " << profileTrace << std::endl;
+    }
+
+    SpaceGame::JobSystem jobs(threadCount);
     SpaceGame::Renderer renderer;
+    renderer.setJobSystem(&jobs);
+    renderer.setProfiler(&profiler);
+    renderer.setBackend(tiled ? SpaceGame::RenderBackend::Tiled : SpaceGame::RenderBackend::Geometry);
     if (!renderer.init(win)) {
         SDL_DestroyWindow(win);
         SDL_Quit();
@@ -30,89 +90,204 @@ int main(int argc, char* argv[]) {
 
     SpaceGame::Camera camera;
     camera.setPosition(glm::dvec3(0, 10, -30));
-    
 
-    SpaceGame::VoxelModel shipModel;
-    if (!shipModel.loadFromFile("data/ship.bin")) {
-        std::cerr << "Error loading ship.bin" << std::endl;
-        renderer.shutdown();
-        SDL_DestroyWindow(win);
-        SDL_Quit();
-        return 1;
+    // The ship loads in the background; the placeholder stands in until it
+    // arrives
+    SpaceGame::ModelCache models;
+    if (watch) {
+        models.setWatchInterval(0.5);
     }
+    SpaceGame::ModelHandle shipHandle = models.load("data/ship.bin");
+    // Latest ship model, handed from the frame to the tick under the mutex
+    std::mutex shipModelMutex;
+    SpaceGame::ModelRef shipModel = models.getPlaceholder();
+    bool reportedLoadError = false;
 
-    SpaceGame::Ship playerShip;
-    playerShip.setVoxelModel(&shipModel);
-    playerShip.setPosition(glm::dvec3(0, 0, 20));
+    // The player and the fleet share one model and live in the simulation's
+    // entity store; only the simulation moves them
+    SpaceGame::Simulation simulation;
+    SpaceGame::EntityStore& world = simulation.getWorld();
+    world.reserve(1 + fleetSize);
+
+    const glm::dvec3 playerPosition(0, 0, 20);
+    SpaceGame::EntityId player = world.create(shipModel, playerPosition);
+    world.setAngularVelocity(player, glm::dvec3(0.0, 0.5, 0.0));
+
+    const int fleetColumns = (int)std::ceil(std::sqrt((double)fleetSize));
+    const double fleetSpacing = 80.0;
+    for (int i = 0; i < fleetSize; ++i) {
+        glm::dvec3 position((i % fleetColumns - 0.5 * (fleetColumns - 1)) * fleetSpacing,
+                            0.0,
+                            150.0 + (i / fleetColumns) * fleetSpacing);
+        SpaceGame::EntityId id = world.create(shipModel, position);
+        world.setAngularVelocity(id, glm::dvec3(0.0, 0.2 + 0.05 * (i % 5), 0.0));
+    }
+
+    camera.lookAt(playerPosition);
+
+    // Model swaps and overlaps happen at the start of every tick, on
+    // whichever thread runs the simulation
+    SpaceGame::CollisionSystem collisions;
+    std::atomic<uint32_t> contactCount(0);
+    SpaceGame::ModelRef assignedModel = shipModel;
+    simulation.setTickFunction([&](SpaceGame::EntityStore& entities, double) {
+        SpaceGame::ModelRef wanted;
+        {
+            std::lock_guard<std::mutex> lock(shipModelMutex);
+            wanted = shipModel;
+        }
+        if (wanted != assignedModel) {
+            entities.replaceModel(assignedModel.get(), wanted);
+            assignedModel = std::move(wanted);
+        }
+        collisions.update(entities);
+        contactCount = collisions.getStats().contacts;
+    });
+
+    simulation.reset();
+    if (simThread) {
+        simulation.start();
+    }
 
-    camera.lookAt(playerShip.getPosition());
+    // Interpolated transforms for the frame being drawn
+    std::vector<glm::dmat4> matrices;
+    std::vector<SpaceGame::ModelRef> frameModels;
 
     bool quit = false;
     SDL_Event e;
+    SpaceGame::Input input;
+    SpaceGame::CameraController cameraController;
 
     const int TARGET_FPS = 60;
-    const double frameDelay = 1000.0 / TARGET_FPS;
+    const Uint64 frameNs = 1000000000ull / TARGET_FPS;
 
-    Uint64 lastTime = SDL_GetTicks();
+    // Frames are paced against absolute deadlines so sleep overshoot does
+    // not accumulate
+    Uint64 lastTime = SDL_GetTicksNS();
+    Uint64 nextFrame = lastTime + frameNs;
+    Uint64 lastTitleUpdate = lastTime;
     double deltaTime = 0;
 
+    // Frame interval statistics over the last title update period
+    double intervalSum = 0.0;
+    double intervalSquareSum = 0.0;
+    int intervalCount = 0;
+
     while (!quit) {
-        Uint64 frameStart = SDL_GetTicks();
-        deltaTime = (frameStart - lastTime) / 1000.0;
+        profiler.beginFrame();
+        Uint64 frameStart = SDL_GetTicksNS();
+        deltaTime = (frameStart - lastTime) * 1e-9;
         lastTime = frameStart;
 
+        double intervalMs = deltaTime * 1000.0;
+        intervalSum += intervalMs;
+        intervalSquareSum += intervalMs * intervalMs;
+        intervalCount++;
+
+        profiler.setCounter("frame interval ms", intervalMs);
+        profiler.setCounter("contacts", contactCount);
+
+        // Events are only buffered here; held keys are read once per frame
+        // by input.sample(), so movement no longer waits on key repeat
+        uint64_t eventStart = SpaceGame::Profiler::now();
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_EVENT_QUIT) {
                 quit = true;
             }
-            if (e.type == SDL_EVENT_KEY_DOWN) {
-                switch (e.key.scancode) {
-                    case SDL_SCANCODE_W:
-                        camera.moveForward(10.0 * deltaTime);
-                        break;
-                    case SDL_SCANCODE_S:
-                        camera.moveForward(-10.0 * deltaTime);
-                        break;
-                    case SDL_SCANCODE_A:
-                        camera.moveRight(-10.0 * deltaTime);
-                        break;
-                    case SDL_SCANCODE_D:
-                        camera.moveRight(10.0 * deltaTime);
-                        break;
-                    case SDL_SCANCODE_UP:
-                        camera.rotate(1.0 * deltaTime, 0, 0);
-                        break;
-                    case SDL_SCANCODE_DOWN:
-                        camera.rotate(-1.0 * deltaTime, 0, 0);
-                        break;
-                    case SDL_SCANCODE_LEFT:
-                        camera.rotate(0, 1.0 * deltaTime, 0);
-                        break;
-                    case SDL_SCANCODE_RIGHT:
-                        camera.rotate(0, -1.0 * deltaTime, 0);
-                        break;
-                }
-            }
+            input.handleEvent(e);
+        }
+        input.sample();
+        if (input.wasPressed(SDL_SCANCODE_M)) {
+            renderer.setRenderMode(renderer.getRenderMode() == SpaceGame::RenderMode::Mesh
+                ? SpaceGame::RenderMode::Voxels : SpaceGame::RenderMode::Mesh);
         }
+        if (input.wasPressed(SDL_SCANCODE_B)) {
+            renderer.setBackend(renderer.getBackend() == SpaceGame::RenderBackend::Tiled
+                ? SpaceGame::RenderBackend::Geometry : SpaceGame::RenderBackend::Tiled);
+        }
+        if (input.wasPressed(SDL_SCANCODE_P)) {
+            profiler.setOverlayVisible(!profiler.isOverlayVisible());
+        }
+        cameraController.update(camera, input, deltaTime);
+        profiler.addSample("events", eventStart, SpaceGame::Profiler::now());
 
-        // Rotate the ship
-        glm::dvec3 rotation = playerShip.getRotation();
-        rotation.y += 0.5 * deltaTime;
-        playerShip.setRotation(rotation);
+        // A superseded model stays alive while the world, a snapshot or
+        // this frame still shares it
+        models.update();
+        {
+            std::lock_guard<std::mutex> lock(shipModelMutex);
+            shipModel = models.resolve(shipHandle);
+        }
+        if (shipHandle.hasFailed() != reportedLoadError) {
+            reportedLoadError = shipHandle.hasFailed();
+            if (reportedLoadError) {
+                std::cerr << "Error loading " << shipHandle.getPath() << std::endl;
+            }
+        }
 
-        playerShip.update(deltaTime);
+        if (!simThread) {
+            PROFILE_SCOPE(&profiler, "simulate");
+            simulation.update();
+        }
+        {
+            PROFILE_SCOPE(&profiler, "interpolate");
+            simulation.interpolate(matrices, frameModels);
+        }
 
+        // Each run of consecutive entities sharing a model is one instanced
+        // draw
         renderer.clear();
-        renderer.drawShip(playerShip, camera);
+        for (size_t begin = 0; begin < frameModels.size();) {
+            size_t end = begin + 1;
+            while (end < frameModels.size() && frameModels[end] == frameModels[begin]) {
+                end++;
+            }
+            renderer.drawShips(*frameModels[begin], matrices.data() + begin, end - begin, camera);
+            begin = end;
+        }
         renderer.present();
+        input.markPresented(SDL_GetTicksNS());
+        profiler.setCounter("input latency ms", input.getLatency().averageMs);
+
+        // Report the render counters, frame pacing and key press to present
+        // latency once a second
+        if (frameStart - lastTitleUpdate >= 1000000000ull) {
+            const SpaceGame::RenderStats& stats = renderer.getStats();
+            double mean = intervalSum / intervalCount;
+            double deviation = std::sqrt(std::max(0.0, intervalSquareSum / intervalCount - mean * mean));
+            char pacing[64];
+            std::snprintf(pacing, sizeof(pacing), "%.2f +/- %.2f ms", mean, deviation);
+            std::string title = std::string("SpaceGame - ")
+                + (renderer.getBackend() == SpaceGame::RenderBackend::Tiled ? "tiled, " : "geometry, ")
+                + std::to_string(stats.drawCalls) + " draw calls, "
+                + std::to_string(stats.quads) + " voxels, " + std::to_string(stats.faces) + " faces, frame " + pacing;
+            SpaceGame::InputLatencyStats latency = input.getLatency();
+            if (latency.samples > 0) {
+                char text[64];
+                std::snprintf(text, sizeof(text), ", input %.1f ms (max %.1f)", latency.averageMs, latency.maxMs);
+                title += text;
+            }
+            SDL_SetWindowTitle(win, title.c_str());
+            lastTitleUpdate = frameStart;
+            intervalSum = intervalSquareSum = 0.0;
+            intervalCount = 0;
+            input.resetLatency();
+        }
 
-        Uint64 frameTime = SDL_GetTicks() - frameStart;
+        profiler.endFrame();
 
-        if (frameDelay > frameTime) {
-            SDL_Delay((Uint32)(frameDelay - frameTime));
+        Uint64 now = SDL_GetTicksNS();
+        if (now < nextFrame) {
+            SDL_DelayPrecise(nextFrame - now);
+            nextFrame += frameNs;
+        } else {
+            // Missed the deadline; start a fresh schedule from now
+            nextFrame = now + frameNs;
         }
     }
 
+    simulation.stop();
+    profiler.close();
     renderer.shutdown();
     SDL_DestroyWindow(win);
     SDL_Quit();
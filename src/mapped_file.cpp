@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SPACEGAME_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace SpaceGame {
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), mapped_(false) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const char* filename) {
+    close();
+
+#ifdef SPACEGAME_HAS_MMAP
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = (size_t)info.st_size;
+    if (size_ > 0) {
+        void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        madvise(address, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(address);
+        mapped_ = true;
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    buffer_.resize((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+        buffer_.clear();
+        return false;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef SPACEGAME_HAS_MMAP
+    if (mapped_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,129 @@
+#include "mesher.h"
+#include <cstring>
+
+namespace SpaceGame {
+
+namespace {
+
+const int SIZE = VoxelIndex::BRICK_SIZE;
+
+uint32_t packColor(const Color& c) {
+    return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+}
+
+Color unpackColor(uint32_t packed) {
+    return Color((uint8_t)packed, (uint8_t)(packed >> 8), (uint8_t)(packed >> 16), (uint8_t)(packed >> 24));
+}
+
+} // namespace
+
+void meshBrick(const VoxelModel& model, const VoxelIndex::Brick& brick, BrickMesh& mesh) {
+    mesh.quads.clear();
+    mesh.faces = 0;
+    mesh.revision = brick.revision;
+    if (brick.count == 0) {
+        return;
+    }
+
+    const std::vector<Voxel>& voxels = model.getVoxels();
+    const int origin[3] = {
+        brick.x * SIZE,
+        brick.y * SIZE,
+        brick.z * SIZE
+    };
+
+    // Packed color of each exposed face in the current slice; the valid flag
+    // keeps fully transparent black distinct from "no face"
+    uint32_t colors[SIZE][SIZE];
+    bool valid[SIZE][SIZE];
+
+    for (int face = 0; face < 6; ++face) {
+        const int axis = face / 2;
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        const int step = (face & 1) ? 1 : -1;
+
+        for (int slice = 0; slice < SIZE; ++slice) {
+            std::memset(valid, 0, sizeof(valid));
+
+            for (int j = 0; j < SIZE; ++j) {
+                for (int i = 0; i < SIZE; ++i) {
+                    int p[3];
+                    p[axis] = origin[axis] + slice;
+                    p[u] = origin[u] + i;
+                    p[v] = origin[v] + j;
+
+                    uint32_t slot = brick.slots[VoxelIndex::cellIndex((int16_t)p[0], (int16_t)p[1], (int16_t)p[2])];
+                    if (slot == VoxelIndex::NONE) {
+                        continue;
+                    }
+
+                    p[axis] += step;
+                    if (model.isOccupied((int16_t)p[0], (int16_t)p[1], (int16_t)p[2])) {
+                        continue;
+                    }
+
+                    colors[j][i] = packColor(voxels[slot].color);
+                    valid[j][i] = true;
+                    mesh.faces++;
+                }
+            }
+
+            // Grow each unclaimed face along u, then along v while the whole
+            // row matches, and emit the rectangle
+            for (int j = 0; j < SIZE; ++j) {
+                for (int i = 0; i < SIZE; ) {
+                    if (!valid[j][i]) {
+                        ++i;
+                        continue;
+                    }
+
+                    uint32_t color = colors[j][i];
+                    int width = 1;
+                    while (i + width < SIZE && valid[j][i + width] && colors[j][i + width] == color) {
+                        ++width;
+                    }
+
+                    int height = 1;
+                    for (; j + height < SIZE; ++height) {
+                        bool rowMatches = true;
+                        for (int k = 0; k < width; ++k) {
+                            if (!valid[j + height][i + k] || colors[j + height][i + k] != color) {
+                                rowMatches = false;
+                                break;
+                            }
+                        }
+                        if (!rowMatches) {
+                            break;
+                        }
+                    }
+
+                    for (int h = 0; h < height; ++h) {
+                        for (int k = 0; k < width; ++k) {
+                            valid[j + h][i + k] = false;
+                        }
+                    }
+
+                    int p[3];
+                    p[axis] = origin[axis] + slice;
+                    p[u] = origin[u] + i;
+                    p[v] = origin[v] + j;
+
+                    MeshQuad quad;
+                    quad.x = (int16_t)p[0];
+                    quad.y = (int16_t)p[1];
+                    quad.z = (int16_t)p[2];
+                    quad.face = (uint8_t)face;
+                    quad.width = (uint8_t)width;
+                    quad.height = (uint8_t)height;
+                    quad.color = unpackColor(color);
+                    mesh.quads.push_back(quad);
+
+                    i += width;
+                }
+            }
+        }
+    }
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// Builds the greedy mesh of one brick. For each face direction and slice,
+// exposed faces of equal color are merged into the largest rectangles that
+// cover them, so flat hull plating collapses to a handful of quads.
+void meshBrick(const VoxelModel& model, const VoxelIndex::Brick& brick, BrickMesh& mesh);
+
+} // namespace SpaceGame
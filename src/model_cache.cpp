@@ -0,0 +1,217 @@
+#include "model_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace SpaceGame {
+
+namespace {
+
+std::filesystem::file_time_type writeTimeOf(const std::string& path) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+// Reads a model and builds everything drawing and collision would otherwise
+// build on first use. Returns null if the file cannot be read.
+ModelRef loadModel(const std::string& path) {
+    auto model = std::make_shared<VoxelModel>();
+    if (!model->loadFromFile(path.c_str())) {
+        return nullptr;
+    }
+    glm::dvec3 min, max;
+    model->getBounds(min, max);
+    model->getOccupancy();
+    for (int level = 1; level < VoxelModel::MAX_LOD_LEVELS; ++level) {
+        model->getLod(level).getSurface();
+    }
+    return model;
+}
+
+// Edges of an 8 voxel cube
+ModelRef buildPlaceholder() {
+    auto model = std::make_shared<VoxelModel>();
+    const int size = 8;
+    const Color color(255, 0, 255);
+    for (int z = 0; z < size; ++z) {
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                int edges = (x == 0 || x == size - 1) + (y == 0 || y == size - 1) + (z == 0 || z == size - 1);
+                if (edges >= 2) {
+                    model->addVoxel({ (int16_t)(x - size / 2), (int16_t)(y - size / 2), (int16_t)(z - size / 2),
+                                     VoxelType::Hull, color });
+                }
+            }
+        }
+    }
+    glm::dvec3 min, max;
+    model->getBounds(min, max);
+    return model;
+}
+
+} // namespace
+
+ModelCache::ModelCache() : stopping_(false), watchIntervalMs_(0), placeholder_(buildPlaceholder()) {
+    thread_ = std::thread(&ModelCache::ioLoop, this);
+}
+
+ModelCache::~ModelCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+ModelHandle ModelCache::load(const std::string& path) {
+    std::string key = std::filesystem::path(path).lexically_normal().generic_string();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        return ModelHandle(found->second);
+    }
+
+    auto entry = std::make_shared<ModelCacheEntry>();
+    entry->path = key;
+    entry->future = entry->firstLoad.get_future().share();
+    entry->queued = true;
+    entries_.emplace(key, entry);
+    queue_.push_back(entry);
+    wake_.notify_one();
+    return ModelHandle(entry);
+}
+
+size_t ModelCache::update() {
+    std::vector<std::pair<std::shared_ptr<ModelCacheEntry>, ModelRef>> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : finished_) {
+            entry->pendingReady = false;
+            finished.emplace_back(entry, std::move(entry->pending));
+        }
+        finished_.clear();
+    }
+
+    size_t published = 0;
+    for (auto& [entry, model] : finished) {
+        if (!model) {
+            entry->failed = true;
+            continue;
+        }
+        entry->model = std::move(model);
+        entry->failed = false;
+        entry->version++;
+        published++;
+    }
+    return published;
+}
+
+void ModelCache::setWatchInterval(double seconds) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watchIntervalMs_ = (int64_t)(std::max(seconds, 0.0) * 1000.0);
+    }
+    wake_.notify_one();
+}
+
+size_t ModelCache::collect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        // Queued or in-flight entries are also held by the queue or the
+        // I/O thread, so only idle ones reach a count of one
+        if (it->second.use_count() == 1) {
+            it = entries_.erase(it);
+            removed++;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+ModelRef ModelCache::resolve(const ModelHandle& handle) const {
+    if (handle.isValid() && handle.isReady()) {
+        return handle.get();
+    }
+    return placeholder_;
+}
+
+void ModelCache::ioLoop() {
+    auto lastCheck = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        int64_t intervalMs = watchIntervalMs_;
+        if (queue_.empty()) {
+            if (intervalMs > 0) {
+                wake_.wait_until(lock, lastCheck + std::chrono::milliseconds(intervalMs));
+            } else {
+                wake_.wait(lock);
+            }
+        }
+        if (stopping_) {
+            return;
+        }
+
+        if (queue_.empty()) {
+            intervalMs = watchIntervalMs_;
+            if (intervalMs > 0 && std::chrono::steady_clock::now() >= lastCheck + std::chrono::milliseconds(intervalMs)) {
+                lastCheck = std::chrono::steady_clock::now();
+                lock.unlock();
+                checkForChanges();
+                lock.lock();
+            }
+            continue;
+        }
+
+        std::shared_ptr<ModelCacheEntry> entry = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        // Stamp the time before reading so a write during the load is seen
+        // as a change next time
+        auto writeTime = writeTimeOf(entry->path);
+        ModelRef model = loadModel(entry->path);
+
+        lock.lock();
+        entry->queued = false;
+        entry->writeTime = writeTime;
+        entry->pending = model;
+        if (!entry->pendingReady) {
+            entry->pendingReady = true;
+            finished_.push_back(entry);
+        }
+        if (!entry->firstLoadDone) {
+            entry->firstLoadDone = true;
+            entry->firstLoad.set_value(model != nullptr);
+        }
+    }
+}
+
+void ModelCache::checkForChanges() {
+    std::vector<std::shared_ptr<ModelCacheEntry>> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& pair : entries_) {
+            if (!pair.second->queued) {
+                entries.push_back(pair.second);
+            }
+        }
+    }
+
+    for (const auto& entry : entries) {
+        auto writeTime = writeTimeOf(entry->path);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!entry->queued && writeTime != entry->writeTime) {
+            entry->queued = true;
+            queue_.push_back(entry);
+        }
+    }
+}
+
+} // namespace SpaceGame
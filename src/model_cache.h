@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "entity_store.h"
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// State of one cached file. The I/O thread fills the pending fields under
+// the cache's mutex; ModelCache::update moves them into the published ones.
+struct ModelCacheEntry {
+    std::string path;
+
+    // Published, read and written only on the thread calling update()
+    ModelRef model;
+    uint32_t version = 0;
+    bool failed = false;
+
+    // Handed over by the I/O thread
+    ModelRef pending;
+    bool pendingReady = false;
+    bool queued = false;
+    std::filesystem::file_time_type writeTime;
+
+    std::promise<bool> firstLoad;
+    std::shared_future<bool> future;
+    bool firstLoadDone = false;
+};
+
+// Shared reference to a cached model. Every handle to one path sees the same
+// model, which may be swapped for a newer version when the file changes.
+// Apart from getFuture, only use a handle on the thread calling
+// ModelCache::update.
+class ModelHandle {
+public:
+    ModelHandle() = default;
+
+    bool isValid() const { return entry_ != nullptr; }
+    const std::string& getPath() const { return entry_->path; }
+
+    // Latest version, or null until the first load succeeds
+    const ModelRef& get() const { return entry_->model; }
+    bool isReady() const { return entry_->model != nullptr; }
+    // The most recent load or reload failed; an earlier version stays in use
+    bool hasFailed() const { return entry_->failed; }
+    // Bumped every time a load or reload is published
+    uint32_t getVersion() const { return entry_->version; }
+
+    // Resolves when the first load finishes, to whether it succeeded; the
+    // model itself reaches get() on the next update(). It carries no model,
+    // so it never keeps a superseded version alive. Can be waited on from
+    // any thread.
+    std::shared_future<bool> getFuture() const { return entry_->future; }
+
+private:
+    friend class ModelCache;
+    explicit ModelHandle(std::shared_ptr<ModelCacheEntry> entry) : entry_(std::move(entry)) {}
+
+    std::shared_ptr<ModelCacheEntry> entry_;
+};
+
+// Loads VoxelModel files on a background I/O thread. Repeated loads of one
+// path share a single model. After reading a file the thread also builds the
+// derived data the renderer and collision need (surface, bounds, detail
+// levels, occupancy), so a model arrives ready to draw. With a watch
+// interval set, the thread polls file modification times and reloads
+// changed files. Models are shared: a version replaced by a reload lives on
+// until the last entity, snapshot or frame holding it lets go.
+class ModelCache {
+public:
+    ModelCache();
+    ~ModelCache();
+
+    ModelCache(const ModelCache&) = delete;
+    ModelCache& operator=(const ModelCache&) = delete;
+
+    // Returns immediately; queues the file unless it is already cached
+    ModelHandle load(const std::string& path);
+
+    // Publishes finished loads and reloads to their handles. Call once per
+    // frame. Returns the number published.
+    size_t update();
+
+    // How often to check cached files for changes; 0 (the default) turns
+    // hot reload off
+    void setWatchInterval(double seconds);
+
+    // Forgets entries no handle refers to any more; returns how many. Their
+    // models stay alive for whoever still shares them. Call on update()'s
+    // thread.
+    size_t collect();
+
+    // Small wireframe cube to draw while a model is loading or missing
+    const ModelRef& getPlaceholder() const { return placeholder_; }
+    // The handle's model, or the placeholder when it has none yet
+    ModelRef resolve(const ModelHandle& handle) const;
+
+private:
+    void ioLoop();
+    // Enqueues entries whose file changed since it was last read
+    void checkForChanges();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unordered_map<std::string, std::shared_ptr<ModelCacheEntry>> entries_;
+    std::deque<std::shared_ptr<ModelCacheEntry>> queue_;
+    std::vector<std::shared_ptr<ModelCacheEntry>> finished_;
+    bool stopping_;
+    std::atomic<int64_t> watchIntervalMs_;
+
+    ModelRef placeholder_;
+    std::thread thread_;
+};
+
+} // namespace SpaceGame
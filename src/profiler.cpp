@@ -0,0 +1,215 @@
+#include "profiler.h"
+#include <chrono>
+#include <cstring>
+
+namespace SpaceGame {
+
+namespace {
+
+// Weight of the newest frame in the overlay's moving averages
+const double SMOOTHING = 0.05;
+
+} // namespace
+
+Profiler::Profiler()
+    : frameIndex_(0),
+      frameStartNs_(0),
+      originNs_(now()),
+      frameMs_(0.0),
+      overlayVisible_(false),
+      csv_(nullptr),
+      trace_(nullptr),
+      traceHasEvents_(false) {}
+
+Profiler::~Profiler() {
+    close();
+}
+
+uint64_t Profiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::beginFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frameStartNs_ = now();
+    samples_.clear();
+    counters_.clear();
+}
+
+void Profiler::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t endNs = now();
+    samples_.push_back({ "frame", frameStartNs_, endNs, threadIndex(std::this_thread::get_id()) });
+
+    // Sum each scope over the frame, then fold the totals into the running
+    // averages. Scopes missing from this frame decay toward zero.
+    std::vector<Counter> totals;
+    for (const Sample& sample : samples_) {
+        double ms = (sample.endNs - sample.startNs) * 1e-6;
+        bool merged = false;
+        for (Counter& total : totals) {
+            if (std::strcmp(total.name, sample.name) == 0) {
+                total.value += ms;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            totals.push_back({ sample.name, ms });
+        }
+    }
+    for (Average& average : averages_) {
+        double ms = 0.0;
+        for (Counter& total : totals) {
+            if (total.name && std::strcmp(total.name, average.name) == 0) {
+                ms = total.value;
+                total.name = nullptr;
+                break;
+            }
+        }
+        average.ms = average.ms * (1.0 - SMOOTHING) + ms * SMOOTHING;
+    }
+    for (const Counter& total : totals) {
+        if (total.name) {
+            averages_.push_back({ total.name, total.value });
+        }
+    }
+
+    double frameMs = (endNs - frameStartNs_) * 1e-6;
+    frameMs_ = frameIndex_ == 0 ? frameMs : frameMs_ * (1.0 - SMOOTHING) + frameMs * SMOOTHING;
+    lastCounters_ = counters_;
+
+    writeFrame();
+    frameIndex_++;
+}
+
+void Profiler::addSample(const char* name, uint64_t startNs, uint64_t endNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.push_back({ name, startNs, endNs, threadIndex(std::this_thread::get_id()) });
+}
+
+void Profiler::setCounter(const char* name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Counter& counter : counters_) {
+        if (std::strcmp(counter.name, name) == 0) {
+            counter.value = value;
+            return;
+        }
+    }
+    counters_.push_back({ name, value });
+}
+
+int Profiler::threadIndex(std::thread::id id) {
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (threads_[i] == id) {
+            return (int)i;
+        }
+    }
+    threads_.push_back(id);
+    return (int)threads_.size() - 1;
+}
+
+bool Profiler::openCsv(const char* filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (csv_) {
+        std::fclose(csv_);
+    }
+    csv_ = std::fopen(filename, "w");
+    if (!csv_) {
+        return false;
+    }
+    std::fprintf(csv_, "frame,kind,name,value\n");
+    return true;
+}
+
+bool Profiler::openTrace(const char* filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (trace_) {
+        std::fprintf(trace_, "\n]\n");
+        std::fclose(trace_);
+    }
+    trace_ = std::fopen(filename, "w");
+    if (!trace_) {
+        return false;
+    }
+    std::fprintf(trace_, "[");
+    traceHasEvents_ = false;
+    return true;
+}
+
+void Profiler::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (csv_) {
+        std::fclose(csv_);
+        csv_ = nullptr;
+    }
+    if (trace_) {
+        std::fprintf(trace_, "\n]\n");
+        std::fclose(trace_);
+        trace_ = nullptr;
+    }
+}
+
+void Profiler::writeFrame() {
+    if (csv_) {
+        for (const Sample& sample : samples_) {
+            std::fprintf(csv_, "%llu,scope,%s,%.4f\n", (unsigned long long)frameIndex_, sample.name,
+                         (sample.endNs - sample.startNs) * 1e-6);
+        }
+        for (const Counter& counter : counters_) {
+            std::fprintf(csv_, "%llu,counter,%s,%g\n", (unsigned long long)frameIndex_, counter.name, counter.value);
+        }
+    }
+
+    if (trace_) {
+        // Complete events ("X") for scopes and counter events ("C"), with
+        // timestamps in microseconds
+        for (const Sample& sample : samples_) {
+            std::fprintf(trace_, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         traceHasEvents_ ? "," : "", sample.name, sample.thread,
+                         (sample.startNs - originNs_) * 1e-3, (sample.endNs - sample.startNs) * 1e-3);
+            traceHasEvents_ = true;
+        }
+        for (const Counter& counter : counters_) {
+            std::fprintf(trace_, "%s\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%g}}",
+                         traceHasEvents_ ? "," : "", counter.name, (frameStartNs_ - originNs_) * 1e-3, counter.value);
+            traceHasEvents_ = true;
+        }
+    }
+}
+
+void Profiler::drawOverlay(SDL_Renderer* renderer) const {
+    // SDL's debug font is 8x8 pixels
+    const float lineHeight = 10.0f;
+    const float x = 8.0f;
+    float y = 8.0f;
+
+    // One line per scope, with the frame line standing in for "frame"
+    size_t lines = averages_.size() + lastCounters_.size();
+    SDL_FRect backdrop = { 4.0f, 4.0f, 300.0f, lines * lineHeight + 8.0f };
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderFillRect(renderer, &backdrop);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+
+    char line[96];
+    std::snprintf(line, sizeof(line), "frame %.2f ms (%.0f fps)", frameMs_, frameMs_ > 0.0 ? 1000.0 / frameMs_ : 0.0);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += lineHeight;
+
+    for (const Average& average : averages_) {
+        if (std::strcmp(average.name, "frame") == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "  %-24s %7.3f ms", average.name, average.ms);
+        SDL_RenderDebugText(renderer, x, y, line);
+        y += lineHeight;
+    }
+    for (const Counter& counter : lastCounters_) {
+        std::snprintf(line, sizeof(line), "  %-24s %9.0f", counter.name, counter.value);
+        SDL_RenderDebugText(renderer, x, y, line);
+        y += lineHeight;
+    }
+}
+
+} // namespace SpaceGame
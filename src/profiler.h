@@ -0,0 +1,119 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SpaceGame {
+
+// Per-frame scope timings and counters. Scopes are recorded through
+// ProfileScope, which does nothing when handed a null profiler, so code can
+// stay instrumented at the cost of one branch. Building with
+// SPACEGAME_NO_PROFILER removes PROFILE_SCOPE entirely.
+//
+// Each finished frame can be shown as an on-screen overlay, appended to a
+// CSV file (one row per scope or counter) and written as Chrome trace events
+// (load the file in chrome://tracing or Perfetto).
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    // Thread safe; name must outlive the profiler, e.g. a string literal
+    void addSample(const char* name, uint64_t startNs, uint64_t endNs);
+    // Value for the current frame; name as for addSample
+    void setCounter(const char* name, double value);
+
+    static uint64_t now();
+
+    bool openCsv(const char* filename);
+    bool openTrace(const char* filename);
+    // Finishes and closes any open output file
+    void close();
+
+    void setOverlayVisible(bool visible) { overlayVisible_ = visible; }
+    bool isOverlayVisible() const { return overlayVisible_; }
+    // Draws smoothed scope times and the last frame's counters
+    void drawOverlay(SDL_Renderer* renderer) const;
+
+private:
+    struct Sample {
+        const char* name;
+        uint64_t startNs;
+        uint64_t endNs;
+        int thread;
+    };
+
+    struct Counter {
+        const char* name;
+        double value;
+    };
+
+    // Exponential moving average of a scope's total time per frame
+    struct Average {
+        const char* name;
+        double ms;
+    };
+
+    int threadIndex(std::thread::id id);
+    void writeFrame();
+
+    std::mutex mutex_;
+    uint64_t frameIndex_;
+    uint64_t frameStartNs_;
+    uint64_t originNs_;                 // Trace timestamps are relative to this
+    std::vector<Sample> samples_;
+    std::vector<Counter> counters_;
+    std::vector<std::thread::id> threads_;
+
+    double frameMs_;
+    std::vector<Average> averages_;
+    std::vector<Counter> lastCounters_;
+    bool overlayVisible_;
+
+    FILE* csv_;
+    FILE* trace_;
+    bool traceHasEvents_;
+};
+
+// Times the enclosing scope into profiler, if there is one
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, const char* name)
+        : profiler_(profiler), name_(name), startNs_(profiler ? Profiler::now() : 0) {}
+    ~ProfileScope() {
+        if (profiler_) {
+            profiler_->addSample(name_, startNs_, Profiler::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* profiler_;
+    const char* name_;
+    uint64_t startNs_;
+};
+
+#define SPACEGAME_PROFILE_CONCAT_INNER(a, b) a##b
+#define SPACEGAME_PROFILE_CONCAT(a, b) SPACEGAME_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SPACEGAME_NO_PROFILER
+#define PROFILE_SCOPE(profiler, name) ((void)0)
+#else
+#define PROFILE_SCOPE(profiler, name) \
+    ::SpaceGame::ProfileScope SPACEGAME_PROFILE_CONCAT(profileScope, __LINE__)(profiler, name)
+#endif
+
+} // namespace SpaceGame
@@ -0,0 +1,285 @@
+// Headless rendering benchmark. Replays a scripted camera path over a model
+// file with SDL's software renderer drawing into a surface, so it needs no
+// window, display or GPU, and prints the frame statistics as JSON.
+//
+// Usage: render_bench [options]
+//   --model FILE     Model to draw (default data/ship.bin)
+//   --frames N       Measured frames (default 300)
+//   --warmup N       Untimed frames before measuring (default 10)
+//   --size WxH       Render target size (default 800x600)
+//   --fleet N        Extra copies of the model in a grid (default 0)
+//   --threads N      Projection threads, 0 uses every core (default 0)
+//   --mode NAME      voxels or mesh (default voxels)
+//   --backend NAME   geometry or tiled (default geometry)
+//   --lod PIXELS     LOD threshold, 0 disables LOD (default 1)
+//   --out FILE       Write the JSON there instead of stdout
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include "camera.h"
+#include "entity.h"
+#include "job_system.h"
+#include "renderer.h"
+#include "voxel.h"
+
+using namespace SpaceGame;
+
+namespace {
+
+struct Options {
+    const char* model = "data/ship.bin";
+    int frames = 300;
+    int warmup = 10;
+    int width = 800;
+    int height = 600;
+    int fleet = 0;
+    int threads = 0;
+    RenderMode mode = RenderMode::Voxels;
+    RenderBackend backend = RenderBackend::Geometry;
+    float lodThreshold = 1.0f;
+    const char* out = nullptr;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--model") == 0) {
+            options.model = value;
+        } else if (std::strcmp(arg, "--frames") == 0) {
+            options.frames = std::max(1, std::atoi(value));
+        } else if (std::strcmp(arg, "--warmup") == 0) {
+            options.warmup = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                std::cerr << "Bad size " << value << ", expected WxH" << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(arg, "--fleet") == 0) {
+            options.fleet = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            options.threads = std::max(0, std::atoi(value));
+        } else if (std::strcmp(arg, "--mode") == 0) {
+            if (std::strcmp(value, "voxels") == 0) {
+                options.mode = RenderMode::Voxels;
+            } else if (std::strcmp(value, "mesh") == 0) {
+                options.mode = RenderMode::Mesh;
+            } else {
+                std::cerr << "Unknown mode " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(arg, "--backend") == 0) {
+            if (std::strcmp(value, "geometry") == 0) {
+                options.backend = RenderBackend::Geometry;
+            } else if (std::strcmp(value, "tiled") == 0) {
+                options.backend = RenderBackend::Tiled;
+            } else {
+                std::cerr << "Unknown backend " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(arg, "--lod") == 0) {
+            options.lodThreshold = (float)std::max(0.0, std::atof(value));
+        } else if (std::strcmp(arg, "--out") == 0) {
+            options.out = value;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Camera for frame i of n: one orbit around the scene while the distance
+// swings between close-up and wide, so both the full-detail and LOD paths
+// and partially off-screen ships are exercised. Depends only on i and n.
+void placeCamera(Camera& camera, int i, int n, const glm::dvec3& center, double radius) {
+    const double TWO_PI = 6.283185307179586;
+    double t = (double)i / n;
+    double angle = TWO_PI * t;
+    double distance = radius * (1.75 + std::cos(2.0 * angle));
+    double height = radius * 0.5 * std::sin(angle);
+    camera.setPosition(center + glm::dvec3(std::sin(angle) * distance, height, -std::cos(angle) * distance));
+    camera.lookAt(center);
+}
+
+// Value at fraction p of the sorted samples, nearest rank
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Contents of a JSON string literal holding text: quotes, backslashes and
+// control characters escaped, everything else (including UTF-8) as is
+std::string escapeJson(const char* text) {
+    std::string escaped;
+    for (const char* c = text; *c; ++c) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+            escaped += (char)ch;
+        } else if (ch < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", ch);
+            escaped += code;
+        } else {
+            escaped += (char)ch;
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    VoxelModel model;
+    if (!model.loadFromFile(options.model)) {
+        std::cerr << "Error loading " << options.model << std::endl;
+        return 1;
+    }
+
+    // The software renderer draws straight into this surface; no video
+    // subsystem is initialised
+    SDL_Surface* surface = SDL_CreateSurface(options.width, options.height, SDL_PIXELFORMAT_XRGB8888);
+    Renderer renderer;
+    if (!surface || !renderer.initSoftware(surface)) {
+        std::cerr << "Could not create software renderer: " << SDL_GetError() << std::endl;
+        SDL_DestroySurface(surface);
+        return 1;
+    }
+
+    JobSystem jobs(options.threads);
+    renderer.setJobSystem(&jobs);
+    renderer.setRenderMode(options.mode);
+    renderer.setBackend(options.backend);
+    renderer.setLodThreshold(options.lodThreshold);
+
+    // The model at the origin plus an optional grid of copies behind it,
+    // each with a fixed orientation
+    glm::dvec3 modelCenter;
+    double modelRadius;
+    model.getBoundingSphere(modelCenter, modelRadius);
+    modelRadius = std::max(modelRadius, 1.0);
+
+    std::vector<glm::dmat4> transforms;
+    transforms.push_back(glm::dmat4(1.0));
+    const int columns = (int)std::ceil(std::sqrt((double)options.fleet));
+    const double spacing = modelRadius * 3.0;
+    for (int i = 0; i < options.fleet; ++i) {
+        glm::dvec3 position((i % columns - 0.5 * (columns - 1)) * spacing,
+                            0.0,
+                            (1 + i / columns) * spacing);
+        transforms.push_back(composeModelMatrix(position, glm::dvec3(0.1 * i, 0.2 * i, 0.0), glm::dvec3(1.0)));
+    }
+
+    glm::dvec3 sceneCenter = modelCenter;
+    double sceneRadius = modelRadius;
+    if (options.fleet > 0) {
+        double depth = (1 + (options.fleet - 1) / columns) * spacing;
+        sceneCenter.z += 0.5 * depth;
+        sceneRadius += 0.5 * std::max(depth, columns * spacing);
+    }
+
+    Camera camera;
+    std::vector<double> frameMs;
+    frameMs.reserve(options.frames);
+    uint64_t primitives = 0;
+    uint64_t voxels = 0;
+    uint64_t lodInstances = 0;
+
+    for (int frame = -options.warmup; frame < options.frames; ++frame) {
+        int step = frame < 0 ? frame + options.warmup : frame;
+        placeCamera(camera, step, options.frames, sceneCenter, sceneRadius);
+
+        auto start = std::chrono::steady_clock::now();
+        renderer.clear();
+        renderer.drawShips(model, transforms.data(), transforms.size(), camera);
+        renderer.present();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (frame >= 0) {
+            frameMs.push_back(ms);
+            // Voxel quads or mesh faces, whichever the mode draws, and the
+            // surface voxels behind them at each ship's detail level
+            primitives += renderer.getStats().quads + renderer.getStats().faces;
+            voxels += renderer.getStats().voxelsConsidered;
+            lodInstances += renderer.getStats().lodInstances;
+        }
+    }
+
+    renderer.setJobSystem(nullptr);
+    renderer.shutdown();
+    SDL_DestroySurface(surface);
+
+    double totalMs = 0.0;
+    for (double ms : frameMs) {
+        totalMs += ms;
+    }
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Room for the fixed fields plus the model path, which has no length limit
+    const std::string modelJson = escapeJson(options.model);
+    std::vector<char> json(1024 + modelJson.size());
+    std::snprintf(json.data(), json.size(),
+        "{\n"
+        "  \"model\": \"%s\",\n"
+        "  \"voxels\": %zu,\n"
+        "  \"instances\": %zu,\n"
+        "  \"width\": %d,\n"
+        "  \"height\": %d,\n"
+        "  \"mode\": \"%s\",\n"
+        "  \"backend\": \"%s\",\n"
+        "  \"lod_threshold\": %.2f,\n"
+        "  \"threads\": %d,\n"
+        "  \"frames\": %d,\n"
+        "  \"min_ms\": %.4f,\n"
+        "  \"avg_ms\": %.4f,\n"
+        "  \"p99_ms\": %.4f,\n"
+        "  \"max_ms\": %.4f,\n"
+        "  \"primitives_per_frame\": %.1f,\n"
+        "  \"voxels_per_frame\": %.1f,\n"
+        "  \"lod_instances_per_frame\": %.2f,\n"
+        "  \"primitives_per_sec\": %.0f,\n"
+        "  \"voxels_per_sec\": %.0f\n"
+        "}\n",
+        modelJson.c_str(), model.getVoxels().size(), transforms.size(), options.width, options.height,
+        options.mode == RenderMode::Mesh ? "mesh" : "voxels",
+        options.backend == RenderBackend::Tiled ? "tiled" : "geometry", options.lodThreshold, jobs.getThreadCount(),
+        options.frames, sorted.front(), totalMs / frameMs.size(), percentile(sorted, 0.99), sorted.back(),
+        (double)primitives / frameMs.size(), (double)voxels / frameMs.size(), (double)lodInstances / frameMs.size(),
+        totalMs > 0.0 ? primitives / (totalMs * 1e-3) : 0.0,
+        totalMs > 0.0 ? voxels / (totalMs * 1e-3) : 0.0);
+
+    if (options.out) {
+        std::ofstream file(options.out);
+        if (!file) {
+            std::cerr << "Cannot write " << options.out << std::endl;
+            return 1;
+        }
+        file << json.data();
+    } else {
+        std::cout << json.data();
+    }
+    return 0;
+}
@@ -1,11 +1,68 @@
 #include "renderer.h"
 #include "ship.h"
+#include "lod.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 namespace SpaceGame {
 
-Renderer::Renderer() : sdlRenderer_(nullptr) {}
+namespace {
+
+// Fixed per-direction shading so flat-colored mesh faces stay readable
+const float FACE_SHADE[6] = { 0.7f, 0.8f, 0.6f, 0.9f, 0.75f, 1.0f };
+
+const uint32_t FACE_BIT = 0x80000000u;
+
+SDL_FColor toFColor(const Color& c) {
+    return { c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f };
+}
+
+// Sort keys span [0, DEPTH_KEY_MAX]; 16 bits resolve well under a voxel
+// across the depth range of a typical frame
+const int DEPTH_KEY_BITS = 16;
+const uint32_t DEPTH_KEY_MAX = (1u << DEPTH_KEY_BITS) - 1;
+
+void writeQuad(SDL_Vertex* out, const ScreenQuad& quad) {
+    SDL_FColor color = toFColor(quad.color);
+    float half = quad.size * 0.5f;
+    float left = quad.x - half;
+    float right = quad.x + half;
+    float top = quad.y - half;
+    float bottom = quad.y + half;
+
+    out[0] = { { left, top }, color, { 0.0f, 0.0f } };
+    out[1] = { { right, top }, color, { 0.0f, 0.0f } };
+    out[2] = { { right, bottom }, color, { 0.0f, 0.0f } };
+    out[3] = { { left, bottom }, color, { 0.0f, 0.0f } };
+}
+
+void writeFace(SDL_Vertex* out, const ScreenFace& face) {
+    SDL_FColor color = toFColor(face.color);
+    for (int c = 0; c < 4; ++c) {
+        out[c] = { face.corners[c], color, { 0.0f, 0.0f } };
+    }
+}
+
+} // namespace
+
+Renderer::Renderer()
+    : sdlRenderer_(nullptr),
+      renderMode_(RenderMode::Voxels),
+      backend_(RenderBackend::Geometry),
+      depthSort_(true),
+      jobs_(nullptr),
+      profiler_(nullptr),
+      width_(0),
+      height_(0),
+      lodThreshold_(1.0f),
+      vertexCount_(0),
+      texture_(nullptr),
+      textureWidth_(0),
+      textureHeight_(0) {}
 
 Renderer::~Renderer() {
     shutdown();
@@ -20,7 +77,21 @@ bool Renderer::init(SDL_Window* window) {
     return true;
 }
 
+bool Renderer::initSoftware(SDL_Surface* surface) {
+    sdlRenderer_ = SDL_CreateSoftwareRenderer(surface);
+    if (sdlRenderer_ == nullptr) {
+        std::cerr << "SDL_CreateSoftwareRenderer Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
 void Renderer::shutdown() {
+    if (texture_) {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+        textureWidth_ = textureHeight_ = 0;
+    }
     if (sdlRenderer_) {
         SDL_DestroyRenderer(sdlRenderer_);
         sdlRenderer_ = nullptr;
@@ -30,52 +101,429 @@ void Renderer::shutdown() {
 void Renderer::clear() {
     SDL_SetRenderDrawColor(sdlRenderer_, 0, 0, 0, 255);
     SDL_RenderClear(sdlRenderer_);
+    SDL_GetRenderOutputSize(sdlRenderer_, &width_, &height_);
+
+    draws_.clear();
+    brickJobs_.clear();
 }
 
 void Renderer::present() {
-    SDL_RenderPresent(sdlRenderer_);
+    {
+        PROFILE_SCOPE(profiler_, "renderer.project");
+        projectDraws();
+    }
+    if (backend_ == RenderBackend::Tiled) {
+        PROFILE_SCOPE(profiler_, "renderer.rasterize");
+        rasterize();
+    } else {
+        if (depthSort_) {
+            PROFILE_SCOPE(profiler_, "renderer.sort");
+            sortByDepth();
+        }
+        {
+            PROFILE_SCOPE(profiler_, "renderer.batch");
+            batchGeometry();
+        }
+        PROFILE_SCOPE(profiler_, "renderer.submit");
+        flush();
+    }
+    {
+        PROFILE_SCOPE(profiler_, "renderer.present");
+        if (profiler_ && profiler_->isOverlayVisible()) {
+            profiler_->drawOverlay(sdlRenderer_);
+        }
+        SDL_RenderPresent(sdlRenderer_);
+    }
+
+    if (profiler_) {
+        profiler_->setCounter("voxels considered", stats_.voxelsConsidered);
+        profiler_->setCounter("voxels culled", stats_.voxelsCulled);
+        profiler_->setCounter("voxels drawn", stats_.quads);
+        profiler_->setCounter("faces drawn", stats_.faces);
+        profiler_->setCounter("ships culled", stats_.shipsCulled);
+        profiler_->setCounter("bricks culled", stats_.bricksCulled);
+        profiler_->setCounter("draw calls", stats_.drawCalls);
+    }
+
+    lastStats_ = stats_;
+    stats_ = RenderStats();
 }
 
 void Renderer::drawShip(const Ship& ship, const Camera& camera) {
-    int width, height;
-    SDL_GetRenderOutputSize(sdlRenderer_, &width, &height);
-
     const VoxelModel* model = ship.getVoxelModel();
     if (!model) {
         return;
     }
 
     glm::dmat4 modelMatrix = ship.getModelMatrix();
+    drawShips(*model, &modelMatrix, 1, camera);
+}
 
-    for (const auto& voxel : model->getVoxels()) {
-        double screenX, screenY, depth;
-        glm::dvec3 modelPos(voxel.x, voxel.y, voxel.z);
-        glm::dvec4 worldPos4 = modelMatrix * glm::dvec4(modelPos, 1.0);
-        glm::dvec3 worldPos(worldPos4);
-
-        if (camera.worldToScreen(worldPos, width, height, screenX, screenY, depth)) {
-            if (depth > 0.0 && depth < 1.0) { // Check if within NDC depth range
-                // Calculate the size of the voxel on screen
-                glm::dvec3 modelPosX = modelPos + glm::dvec3(0.5, 0.0, 0.0);
-                glm::dvec4 worldPosX4 = modelMatrix * glm::dvec4(modelPosX, 1.0);
-                glm::dvec3 worldPosX(worldPosX4);
-                
-                double screenX2, screenY2, depth2;
-                if (camera.worldToScreen(worldPosX, width, height, screenX2, screenY2, depth2)) {
-                    double pixelSize = std::abs(screenX2 - screenX) * 2.0;
-
-                    SDL_FRect rect = {
-                        (float)(screenX - pixelSize / 2.0), 
-                        (float)(screenY - pixelSize / 2.0), 
-                        (float)pixelSize, 
-                        (float)pixelSize
-                    };
-                    SDL_SetRenderDrawColor(sdlRenderer_, voxel.color.r, voxel.color.g, voxel.color.b, voxel.color.a);
-                    SDL_RenderFillRect(sdlRenderer_, &rect);
-                }
+void Renderer::drawShips(const VoxelModel& model, const glm::dmat4* transforms, size_t count,
+                         const Camera& camera) {
+    if (count == 0) {
+        return;
+    }
+    PROFILE_SCOPE(profiler_, "renderer.cull");
+
+    // Everything that depends only on the model or the camera is done once
+    // for all instances
+    glm::dmat4 projection = camera.getProjectionMatrix(width_, height_);
+    glm::dmat4 viewProjection = projection * camera.getViewMatrix();
+    Frustum worldFrustum = Frustum::fromMatrix(viewProjection);
+
+    glm::dvec3 center;
+    double radius;
+    model.getBoundingSphere(center, radius);
+
+    // Detail levels are looked up on first use and shared by every instance
+    // that selects them
+    struct Level {
+        const VoxelModel* model = nullptr;
+        const std::vector<SurfaceBrick>* surface = nullptr;
+        const std::vector<BrickMesh>* mesh = nullptr;
+        glm::dmat4 toModel;
+        uint32_t voxelCount = 0;
+    };
+    Level levels[VoxelModel::MAX_LOD_LEVELS];
+
+    for (size_t instance = 0; instance < count; ++instance) {
+        const glm::dmat4& modelMatrix = transforms[instance];
+
+        double voxelSize = glm::length(glm::dvec3(modelMatrix[0]));
+        double maxScale = std::max(voxelSize, std::max(glm::length(glm::dvec3(modelMatrix[1])),
+                                                       glm::length(glm::dvec3(modelMatrix[2]))));
+        glm::dvec3 worldCenter(modelMatrix * glm::dvec4(center, 1.0));
+
+        // A unit voxel at distance d covers pixelScale / d pixels. Halve the
+        // resolution until voxels reach the LOD threshold.
+        double pixelScale = voxelSize * projection[0][0] * 0.5 * width_;
+        double distance = std::max(glm::length(worldCenter - camera.getPosition()), 1e-6);
+        double pixelSize = pixelScale / distance;
+        int lod = 0;
+        while (lod + 1 < VoxelModel::MAX_LOD_LEVELS && pixelSize * (1 << lod) < lodThreshold_) {
+            lod++;
+        }
+
+        // Refresh the level's caches here, on the calling thread, so the
+        // projection jobs only ever read them. Enclosed voxels can never be
+        // seen, so voxel mode draws only the cached surface.
+        Level& level = levels[lod];
+        if (!level.model) {
+            level.model = &model.getLod(lod);
+            level.surface = &level.model->getSurface();
+            level.mesh = renderMode_ == RenderMode::Mesh ? &level.model->getMesh() : nullptr;
+            level.toModel = lodToModel(lod);
+            level.voxelCount = (uint32_t)level.model->getSurfaceVoxelCount();
+        }
+        stats_.voxelsConsidered += level.voxelCount;
+
+        // Reject the whole ship when its bounding sphere is outside the frustum
+        if (!worldFrustum.intersectsSphere(worldCenter, radius * maxScale)) {
+            stats_.shipsCulled++;
+            stats_.voxelsCulled += level.voxelCount;
+            continue;
+        }
+        if (lod > 0) {
+            stats_.lodInstances++;
+        }
+
+        // Build the full transform once per ship instead of once per voxel
+        glm::dmat4 levelMatrix = modelMatrix * level.toModel;
+        ShipDraw draw;
+        draw.surface = level.mesh ? nullptr : level.surface;
+        draw.mesh = level.mesh;
+        draw.mvp = viewProjection * levelMatrix;
+        draw.eye = glm::dvec3(glm::inverse(levelMatrix) * glm::dvec4(camera.getPosition(), 1.0));
+
+        for (int col = 0; col < 4; ++col) {
+            for (int row = 0; row < 4; ++row) {
+                draw.params.mvp[col * 4 + row] = (float)draw.mvp[col][row];
             }
         }
+        draw.params.width = (float)width_;
+        draw.params.height = (float)height_;
+        draw.params.pixelScale = (float)(pixelScale * (1 << lod));
+
+        // Planes of the MVP matrix are the frustum in model space, so brick
+        // boxes are tested without transforming them
+        Frustum localFrustum = Frustum::fromMatrix(draw.mvp);
+        const std::vector<SurfaceBrick>& surface = *level.surface;
+        uint32_t drawIndex = (uint32_t)draws_.size();
+        for (size_t i = 0; i < surface.size(); ++i) {
+            const SurfaceBrick& brick = surface[i];
+            if (brick.voxels.size() == 0) {
+                continue;
+            }
+            if (!localFrustum.intersectsBox(brick.boundsMin, brick.boundsMax)) {
+                stats_.bricksCulled++;
+                stats_.voxelsCulled += (uint32_t)brick.voxels.size();
+                continue;
+            }
+            brickJobs_.push_back({ drawIndex, (uint32_t)i });
+        }
+        draws_.push_back(draw);
+    }
+}
+
+void Renderer::projectDraws() {
+    size_t threadCount = jobs_ ? (size_t)jobs_->getThreadCount() : 1;
+    workerBuffers_.resize(threadCount);
+    for (auto& buffers : workerBuffers_) {
+        buffers.quads.clear();
+        buffers.faces.clear();
+        buffers.voxelsRejected = 0;
+    }
+
+    auto projectRange = [this](size_t begin, size_t end, int worker) {
+        WorkerBuffers& out = workerBuffers_[worker];
+        for (size_t i = begin; i < end; ++i) {
+            const BrickJob& job = brickJobs_[i];
+            const ShipDraw& draw = draws_[job.draw];
+            if (draw.mesh) {
+                projectFaces((*draw.mesh)[job.brick].quads, draw.mvp, draw.eye, out.faces);
+            } else {
+                const VoxelSoA& voxels = (*draw.surface)[job.brick].voxels;
+                size_t written = projectVoxels(voxels, draw.params, out.quads);
+                out.voxelsRejected += (uint32_t)(voxels.size() - written);
+            }
+        }
+    };
+
+    // Bricks hold at most 512 voxels, so hand them out a few at a time
+    const size_t bricksPerJob = 4;
+    if (jobs_) {
+        jobs_->parallelFor(brickJobs_.size(), bricksPerJob, projectRange, &threadTimes_);
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        projectRange(0, brickJobs_.size(), 0);
+        threadTimes_.assign(1, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     }
+
+    quads_.clear();
+    faces_.clear();
+    for (const auto& buffers : workerBuffers_) {
+        quads_.insert(quads_.end(), buffers.quads.begin(), buffers.quads.end());
+        faces_.insert(faces_.end(), buffers.faces.begin(), buffers.faces.end());
+        stats_.voxelsCulled += buffers.voxelsRejected;
+    }
+    stats_.quads += (uint32_t)quads_.size();
+    stats_.faces += (uint32_t)faces_.size();
+}
+
+size_t Renderer::projectVoxels(const VoxelSoA& voxels, const TransformParams& params,
+                               std::vector<ScreenQuad>& out) const {
+    size_t first = out.size();
+    out.resize(first + voxels.size());
+    size_t written = transformVoxels(voxels, params, out.data() + first);
+    out.resize(first + written);
+    return written;
+}
+
+void Renderer::projectFaces(const std::vector<MeshQuad>& quads, const glm::dmat4& mvp,
+                            const glm::dvec3& eye, std::vector<ScreenFace>& out) const {
+    const double halfWidth = 0.5 * width_;
+    const double halfHeight = 0.5 * height_;
+
+    for (const auto& quad : quads) {
+        const int axis = quad.face / 2;
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        const bool positive = (quad.face & 1) != 0;
+
+        // Voxels are centered on integer coordinates, so faces lie on half steps
+        glm::dvec3 base(quad.x - 0.5, quad.y - 0.5, quad.z - 0.5);
+        if (positive) {
+            base[axis] += 1.0;
+        }
+
+        // Skip faces pointing away from the camera
+        double facing = eye[axis] - base[axis];
+        if (positive ? facing <= 0.0 : facing >= 0.0) {
+            continue;
+        }
+
+        glm::dvec3 corners[4] = { base, base, base, base };
+        corners[1][u] += quad.width;
+        corners[2][u] += quad.width;
+        corners[2][v] += quad.height;
+        corners[3][v] += quad.height;
+
+        ScreenFace screenFace;
+        double distanceSum = 0.0;
+        bool visible = true;
+        for (int c = 0; c < 4 && visible; ++c) {
+            glm::dvec4 clipPos = mvp * glm::dvec4(corners[c], 1.0);
+            if (clipPos.w <= 0.0) {
+                visible = false;
+                break;
+            }
+            double invW = 1.0 / clipPos.w;
+            screenFace.corners[c].x = (float)((clipPos.x * invW + 1.0) * halfWidth);
+            screenFace.corners[c].y = (float)((1.0 - clipPos.y * invW) * halfHeight);
+            screenFace.cornerDepths[c] = (float)clipPos.w;
+            distanceSum += clipPos.w;
+        }
+        if (!visible) {
+            continue;
+        }
+
+        float shade = FACE_SHADE[quad.face];
+        screenFace.depth = (float)(distanceSum * 0.25);
+        screenFace.color = Color((uint8_t)(quad.color.r * shade),
+                                 (uint8_t)(quad.color.g * shade),
+                                 (uint8_t)(quad.color.b * shade),
+                                 quad.color.a);
+        out.push_back(screenFace);
+    }
+}
+
+void Renderer::sortByDepth() {
+    const size_t count = quads_.size() + faces_.size();
+    drawOrder_.resize(count);
+    sortScratch_.resize(count);
+    if (count == 0) {
+        return;
+    }
+
+    // Keys are depths quantised over this frame's depth range rather than
+    // raw float bits, so two counting passes order the frame instead of four
+    float nearest = std::numeric_limits<float>::max();
+    float farthest = 0.0f;
+    for (const auto& quad : quads_) {
+        nearest = std::min(nearest, quad.depth);
+        farthest = std::max(farthest, quad.depth);
+    }
+    for (const auto& face : faces_) {
+        nearest = std::min(nearest, face.depth);
+        farthest = std::max(farthest, face.depth);
+    }
+    const float range = farthest - nearest;
+    const float scale = range > 0.0f ? (float)DEPTH_KEY_MAX / range : 0.0f;
+
+    // Farthest first: the key counts down from the far end of the range
+    for (size_t i = 0; i < quads_.size(); ++i) {
+        drawOrder_[i] = { (uint32_t)((farthest - quads_[i].depth) * scale), (uint32_t)i };
+    }
+    for (size_t i = 0; i < faces_.size(); ++i) {
+        drawOrder_[quads_.size() + i] = { (uint32_t)((farthest - faces_[i].depth) * scale), (uint32_t)i | FACE_BIT };
+    }
+
+    // Stable counting passes, one per key byte. A pass is skipped when every
+    // key shares the same byte.
+    DepthKey* src = drawOrder_.data();
+    DepthKey* dst = sortScratch_.data();
+    for (int shift = 0; shift < DEPTH_KEY_BITS; shift += 8) {
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; ++i) {
+            offsets[(src[i].key >> shift) & 0xFF]++;
+        }
+        if (offsets[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t total = 0;
+        for (size_t& offset : offsets) {
+            size_t bucket = offset;
+            offset = total;
+            total += bucket;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != drawOrder_.data()) {
+        drawOrder_.swap(sortScratch_);
+    }
+}
+
+void Renderer::batchGeometry() {
+    const size_t count = quads_.size() + faces_.size();
+
+    // The buffer only grows; shrinking and regrowing it every frame would
+    // value-initialise every vertex again before it is overwritten
+    vertexCount_ = count * 4;
+    if (vertices_.size() < vertexCount_) {
+        vertices_.resize(vertexCount_);
+    }
+    SDL_Vertex* out = vertices_.data();
+
+    if (depthSort_) {
+        for (const auto& item : drawOrder_) {
+            if (item.index & FACE_BIT) {
+                writeFace(out, faces_[item.index & ~FACE_BIT]);
+            } else {
+                writeQuad(out, quads_[item.index]);
+            }
+            out += 4;
+        }
+    } else {
+        for (const auto& quad : quads_) {
+            writeQuad(out, quad);
+            out += 4;
+        }
+        for (const auto& face : faces_) {
+            writeFace(out, face);
+            out += 4;
+        }
+    }
+
+}
+
+void Renderer::flush() {
+    if (vertexCount_ == 0) {
+        return;
+    }
+
+    // Every quad uses the same two-triangle pattern, so the index buffer is
+    // extended only when the frame holds more quads than ever before
+    size_t quadCount = vertexCount_ / 4;
+    for (size_t i = indices_.size() / 6; i < quadCount; ++i) {
+        int base = (int)(i * 4);
+        indices_.insert(indices_.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+    }
+
+    SDL_RenderGeometry(sdlRenderer_, nullptr, vertices_.data(), (int)vertexCount_,
+                       indices_.data(), (int)(quadCount * 6));
+    stats_.drawCalls++;
+
+    vertexCount_ = 0;
+}
+
+void Renderer::rasterize() {
+    if (width_ <= 0 || height_ <= 0) {
+        return;
+    }
+    if (!texture_ || textureWidth_ != width_ || textureHeight_ != height_) {
+        if (texture_) {
+            SDL_DestroyTexture(texture_);
+        }
+        texture_ = SDL_CreateTexture(sdlRenderer_, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                     width_, height_);
+        if (!texture_) {
+            std::cerr << "SDL_CreateTexture Error: " << SDL_GetError() << std::endl;
+            textureWidth_ = textureHeight_ = 0;
+            return;
+        }
+        textureWidth_ = width_;
+        textureHeight_ = height_;
+    }
+
+    // Tiles write their finished rows straight into the texture's memory,
+    // so the frame is uploaded once, on unlock
+    void* pixels = nullptr;
+    int pitch = 0;
+    if (!SDL_LockTexture(texture_, nullptr, &pixels, &pitch)) {
+        std::cerr << "SDL_LockTexture Error: " << SDL_GetError() << std::endl;
+        return;
+    }
+    rasterizer_.draw(quads_, faces_, 0, (uint32_t*)pixels, pitch, width_, height_, jobs_);
+    SDL_UnlockTexture(texture_);
+
+    SDL_RenderTexture(sdlRenderer_, texture_, nullptr, nullptr);
+    stats_.drawCalls++;
 }
 
-} // namespace SpaceGame
\ No newline at end of file
+} // namespace SpaceGame
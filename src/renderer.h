@@ -1,30 +1,182 @@
 #pragma once
 
 #include <SDL3/SDL.h>
+#include <vector>
 #include "ship.h"
 #include "camera.h"
+#include "job_system.h"
+#include "profiler.h"
+#include "tile_rasterizer.h"
+#include "transform_kernel.h"
 
 namespace SpaceGame {
 
 class Ship;
 
+enum class RenderMode {
+    Voxels,     // One screen-aligned square per surface voxel
+    Mesh        // Greedy-meshed faces
+};
+
+// How projected primitives become pixels
+enum class RenderBackend {
+    Geometry,   // Depth sorted and submitted with SDL_RenderGeometry
+    Tiled       // TileRasterizer on the CPU, uploaded as one streaming texture
+};
+
+// Counters collected over one frame
+struct RenderStats {
+    uint32_t drawCalls = 0;     // Geometry or texture submissions to SDL
+    uint32_t quads = 0;         // Voxel quads drawn
+    uint32_t faces = 0;         // Greedy-mesh faces drawn
+    uint32_t voxelsConsidered = 0;  // Surface voxels of every queued ship at its detail level
+    uint32_t voxelsCulled = 0;  // Of those, rejected with their ship or brick or by the
+                                // transform kernel (voxel mode only)
+    uint32_t shipsCulled = 0;   // Ships rejected by their bounding sphere
+    uint32_t bricksCulled = 0;  // Bricks rejected by their bounding box
+    uint32_t lodInstances = 0;  // Ships drawn below full detail
+};
+
 class Renderer {
 public:
     Renderer();
     ~Renderer();
 
     bool init(SDL_Window* window);
+    // Renders into a surface with SDL's software renderer, no window needed
+    bool initSoftware(SDL_Surface* surface);
     void shutdown();
 
     void clear();
     void present();
 
+    // Queues the ship; projection runs for every queued ship in present()
     void drawShip(const Ship& ship, const Camera& camera);
 
+    // Queues count instances of one model, one model matrix each. The
+    // model's surface, mesh and bounds are fetched once for all of them.
+    void drawShips(const VoxelModel& model, const glm::dmat4* transforms, size_t count,
+                   const Camera& camera);
+
+    // Spreads projection across the job system's threads. Pass nullptr to
+    // project on the calling thread. The job system must outlive its use.
+    void setJobSystem(JobSystem* jobs) { jobs_ = jobs; }
+
+    // Times queueing, projection, sorting, batching and submission and
+    // publishes the frame's counters. Pass nullptr to disable.
+    void setProfiler(Profiler* profiler) { profiler_ = profiler; }
+
+    // Busy time of each thread during the last frame's projection, in ms
+    const std::vector<double>& getThreadTimes() const { return threadTimes_; }
+
     SDL_Renderer* getSDLRenderer() const { return sdlRenderer_; }
 
+    void setRenderMode(RenderMode mode) { renderMode_ = mode; }
+    RenderMode getRenderMode() const { return renderMode_; }
+
+    // Can be switched between frames
+    void setBackend(RenderBackend backend) { backend_ = backend; }
+    RenderBackend getBackend() const { return backend_; }
+
+    // Sorts every primitive of the frame back to front before submission.
+    // The tiled backend has a depth buffer and never sorts.
+    void setDepthSort(bool enabled) { depthSort_ = enabled; }
+    bool getDepthSort() const { return depthSort_; }
+
+    // Ships whose voxels would project smaller than this many pixels are
+    // drawn from a downsampled level, one level per halving. 0 disables LOD.
+    void setLodThreshold(float pixels) { lodThreshold_ = pixels; }
+    float getLodThreshold() const { return lodThreshold_; }
+
+    // Counters for the most recently presented frame
+    const RenderStats& getStats() const { return lastStats_; }
+
 private:
+    // Everything needed to project one queued ship
+    struct ShipDraw {
+        const std::vector<SurfaceBrick>* surface;   // Set in voxel mode
+        const std::vector<BrickMesh>* mesh;         // Set in mesh mode
+        glm::dmat4 mvp;
+        glm::dvec3 eye;         // Camera position in model space
+        TransformParams params; // Single-precision constants for the voxel kernel
+    };
+
+    // One brick of one queued ship, the unit of parallel work
+    struct BrickJob {
+        uint32_t draw;
+        uint32_t brick;
+    };
+
+    // Per-thread output, merged into quads_ and faces_ after projection
+    struct WorkerBuffers {
+        std::vector<ScreenQuad> quads;
+        std::vector<ScreenFace> faces;
+        uint32_t voxelsRejected = 0;    // Dropped by the transform kernel
+    };
+
+    // Runs every queued BrickJob, in parallel when a job system is set
+    void projectDraws();
+
+    // Runs the transform kernel over the voxels and appends the visible
+    // ones to out; returns how many were appended
+    size_t projectVoxels(const VoxelSoA& voxels, const TransformParams& params,
+                         std::vector<ScreenQuad>& out) const;
+
+    // Projects the front-facing mesh quads and appends them to out.
+    // eye is the camera position in model space.
+    void projectFaces(const std::vector<MeshQuad>& quads, const glm::dmat4& mvp,
+                      const glm::dvec3& eye, std::vector<ScreenFace>& out) const;
+
+    // Orders quads_ and faces_ far to near into drawOrder_ with an LSD radix
+    // sort on their depth, quantised over the frame's depth range
+    void sortByDepth();
+
+    // Writes the frame's quads and faces into the vertex buffer, in
+    // drawOrder_ when depth sorting is enabled
+    void batchGeometry();
+
+    // Submits the batched geometry with a single SDL_RenderGeometry call
+    void flush();
+
+    // Rasterises the frame's quads and faces straight into the locked
+    // streaming texture and draws it over the whole target
+    void rasterize();
+
+    // Sort key for one primitive; the top bit of index selects faces_
+    struct DepthKey {
+        uint32_t key;
+        uint32_t index;
+    };
+
     SDL_Renderer* sdlRenderer_;
+    RenderMode renderMode_;
+    RenderBackend backend_;
+    bool depthSort_;
+    JobSystem* jobs_;
+    Profiler* profiler_;
+    int width_, height_;
+    float lodThreshold_;
+
+    std::vector<ShipDraw> draws_;
+    std::vector<BrickJob> brickJobs_;
+    std::vector<WorkerBuffers> workerBuffers_;
+    std::vector<double> threadTimes_;
+
+    // Primitives of every ship drawn this frame, reused to avoid reallocation
+    std::vector<ScreenQuad> quads_;
+    std::vector<ScreenFace> faces_;
+    std::vector<DepthKey> drawOrder_;
+    std::vector<DepthKey> sortScratch_;
+    std::vector<SDL_Vertex> vertices_;  // Only ever grows, see vertexCount_
+    size_t vertexCount_;                // Vertices batched this frame
+    std::vector<int> indices_;          // Fixed quad pattern, only ever grows
+
+    // Tiled backend; the texture is recreated when the target size changes
+    TileRasterizer rasterizer_;
+    SDL_Texture* texture_;
+    int textureWidth_, textureHeight_;
+    RenderStats stats_;
+    RenderStats lastStats_;
 };
 
 } // namespace SpaceGame
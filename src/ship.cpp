@@ -1,11 +1,75 @@
 #include "ship.h"
+#include <algorithm>
 
 namespace SpaceGame {
 
+namespace {
+
+Ray transformRay(const glm::dmat4& toModel, const Ray& ray) {
+    return { glm::dvec3(toModel * glm::dvec4(ray.origin, 1.0)),
+             glm::dvec3(toModel * glm::dvec4(ray.direction, 0.0)),
+             ray.maxDistance };
+}
+
+} // namespace
+
 Ship::Ship() : model_(nullptr) {}
 
 Ship::~Ship() {}
 
+VoxelModel* Ship::getEditableModel() {
+    if (!model_ && sharedModel_) {
+        auto copy = std::make_shared<VoxelModel>(*sharedModel_);
+        model_ = copy.get();
+        sharedModel_ = std::move(copy);
+    }
+    return model_;
+}
+
+bool Ship::raycast(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                   RayHit& hit) const {
+    const VoxelModel* model = getVoxelModel();
+    if (!model) {
+        return false;
+    }
+    Ray local = transformRay(glm::inverse(getModelMatrix()), { origin, direction, maxDistance });
+    return model->raycast(local.origin, local.direction, local.maxDistance, hit);
+}
+
+size_t Ship::raycast(const Ray* rays, size_t count, RayHit* hits, bool* found, JobSystem* jobs) const {
+    const VoxelModel* model = getVoxelModel();
+    if (!model) {
+        std::fill(found, found + count, false);
+        return 0;
+    }
+    glm::dmat4 toModel = glm::inverse(getModelMatrix());
+    std::vector<Ray> local(count);
+    for (size_t i = 0; i < count; ++i) {
+        local[i] = transformRay(toModel, rays[i]);
+    }
+    return model->raycast(local.data(), count, hits, found, jobs);
+}
+
+DamageResult Ship::applyBlast(const glm::dvec3& center, double radius, double damage) {
+    VoxelModel* model = getEditableModel();
+    if (!model) {
+        return DamageResult();
+    }
+    glm::dmat4 toModel = glm::inverse(getModelMatrix());
+    glm::dvec3 localCenter(toModel * glm::dvec4(center, 1.0));
+    return model->applyBlast(localCenter, radius / scale_.x, damage);
+}
+
+DamageResult Ship::applyRayHit(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                               double damage, RayHit* hit) {
+    VoxelModel* model = getEditableModel();
+    if (!model) {
+        return DamageResult();
+    }
+    Ray local = transformRay(glm::inverse(getModelMatrix()), { origin, direction, maxDistance });
+    return model->applyRayHit(local.origin, local.direction, local.maxDistance, damage, hit);
+}
+
 void Ship::update(double deltaTime) {
     // TODO: Implement ship logic
 }
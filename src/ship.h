@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include "entity.h"
 #include "voxel.h"
 
@@ -10,14 +11,37 @@ public:
     Ship();
     ~Ship();
 
-    void setVoxelModel(VoxelModel* model) { model_ = model; }
-    const VoxelModel* getVoxelModel() const { return model_; }
+    // Borrows a model the caller owns; damage edits it in place
+    void setVoxelModel(VoxelModel* model) { model_ = model; sharedModel_.reset(); }
+    // Shares a model, typically from a ModelCache. The first damage gives
+    // the ship a private copy, leaving the shared one untouched.
+    void setVoxelModel(std::shared_ptr<const VoxelModel> model) { model_ = nullptr; sharedModel_ = std::move(model); }
+    const VoxelModel* getVoxelModel() const { return model_ ? model_ : sharedModel_.get(); }
+
+    // World-space ray queries; see VoxelModel::raycast. Rays are moved into
+    // model space with the inverse model matrix, so hit distances stay in
+    // units of the world direction's length.
+    bool raycast(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                 RayHit& hit) const;
+    size_t raycast(const Ray* rays, size_t count, RayHit* hits, bool* found,
+                   JobSystem* jobs = nullptr) const;
+
+    // World-space wrappers for VoxelModel::applyBlast and applyRayHit.
+    // Distances are in world units and assume a uniform scale. A borrowed
+    // model is edited in place, so ships borrowing it all show the damage.
+    DamageResult applyBlast(const glm::dvec3& center, double radius, double damage);
+    DamageResult applyRayHit(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                             double damage, RayHit* hit = nullptr);
 
     void update(double deltaTime) override;
     void draw() override;
 
 private:
-    VoxelModel* model_;
+    // The model damage may edit, copying a shared one first
+    VoxelModel* getEditableModel();
+
+    VoxelModel* model_;                             // Editable, or null
+    std::shared_ptr<const VoxelModel> sharedModel_; // Owns model_ once copied
 };
 
 } // namespace SpaceGame
@@ -0,0 +1,121 @@
+#include "simulation.h"
+#include "entity.h"
+#include <algorithm>
+
+namespace SpaceGame {
+
+Simulation::Simulation(double tickRate, Clock clock)
+    : clock_(clock),
+      tickNs_((Uint64)(1e9 / tickRate)),
+      startNs_(0),
+      tickCount_(0),
+      running_(false) {}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+void Simulation::reset() {
+    startNs_ = clock_();
+    tickCount_ = 0;
+    publish(startNs_);
+    publish(startNs_);
+}
+
+void Simulation::update() {
+    const Uint64 now = clock_();
+
+    int steps = 0;
+    while (startNs_ + (tickCount_ + 1) * tickNs_ <= now) {
+        if (steps == MAX_CATCH_UP_TICKS) {
+            // Too far behind: forget the missed time rather than replay it
+            startNs_ = now - tickCount_ * tickNs_;
+            break;
+        }
+        tick();
+        steps++;
+    }
+}
+
+void Simulation::tick() {
+    const double tickSeconds = getTickSeconds();
+    if (tickFunction_) {
+        tickFunction_(world_, tickSeconds);
+    }
+    world_.integrate(tickSeconds);
+
+    tickCount_++;
+    publish(startNs_ + tickCount_ * tickNs_);
+}
+
+void Simulation::publish(Uint64 timeNs) {
+    scratch_.timeNs = timeNs;
+    scratch_.ids = world_.getIds();
+    scratch_.models = world_.getModels();
+    scratch_.positions = world_.getPositions();
+    scratch_.rotations = world_.getRotations();
+    scratch_.scales = world_.getScales();
+
+    // Rotate the buffers: current becomes previous, the new tick becomes
+    // current and the old previous is reused for the next tick
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    std::swap(previous_, current_);
+    std::swap(current_, scratch_);
+}
+
+void Simulation::interpolate(std::vector<glm::dmat4>& matrices, std::vector<ModelRef>& models) const {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+
+    // Rendering runs one tick behind, so the current time falls between the
+    // two snapshots
+    const Uint64 now = clock_();
+    double alpha = now > current_.timeNs ? (double)(now - current_.timeNs) / (double)tickNs_ : 0.0;
+    alpha = std::min(alpha, 1.0);
+
+    const size_t count = current_.ids.size();
+    matrices.resize(count);
+    models.assign(current_.models.begin(), current_.models.end());
+
+    // Entities created or swap-moved since the previous tick have no matching
+    // previous slot and are drawn where they are now
+    const bool sameLayout = previous_.ids == current_.ids;
+    for (size_t i = 0; i < count; ++i) {
+        if (!sameLayout) {
+            matrices[i] = composeModelMatrix(current_.positions[i], current_.rotations[i], current_.scales[i]);
+            continue;
+        }
+        matrices[i] = composeModelMatrix(glm::mix(previous_.positions[i], current_.positions[i], alpha),
+                                         glm::mix(previous_.rotations[i], current_.rotations[i], alpha),
+                                         glm::mix(previous_.scales[i], current_.scales[i], alpha));
+    }
+}
+
+void Simulation::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&Simulation::threadLoop, this);
+}
+
+void Simulation::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    thread_.join();
+}
+
+void Simulation::threadLoop() {
+    while (running_) {
+        update();
+
+        Uint64 next = startNs_ + (tickCount_ + 1) * tickNs_;
+        Uint64 now = clock_();
+        if (next > now) {
+            SDL_DelayPrecise(next - now);
+        }
+    }
+}
+
+} // namespace SpaceGame
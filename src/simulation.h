@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "entity_store.h"
+
+namespace SpaceGame {
+
+// Fixed-timestep simulation of an EntityStore, decoupled from rendering.
+// The world advances in ticks of exactly 1 / tickRate seconds whatever the
+// frame rate, so a run is reproducible. After every tick the transforms are
+// published as a snapshot; the renderer interpolates between the last two
+// snapshots, one tick behind real time, so motion stays smooth at any frame
+// rate. Ticks can run on the calling thread through update() or on a thread
+// of their own through start().
+class Simulation {
+public:
+    // Returns the current time in nanoseconds
+    using Clock = Uint64 (*)();
+    // Game logic run at the start of every tick, before integration
+    using TickFunction = std::function<void(EntityStore& world, double tickSeconds)>;
+
+    // Ticks that one update() may run before it drops the backlog, so a long
+    // stall does not turn into a spiral of catch-up ticks
+    static constexpr int MAX_CATCH_UP_TICKS = 8;
+
+    explicit Simulation(double tickRate = 60.0, Clock clock = SDL_GetTicksNS);
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Only valid while the simulation thread is stopped
+    EntityStore& getWorld() { return world_; }
+    void setTickFunction(TickFunction fn) { tickFunction_ = std::move(fn); }
+
+    // Restarts the tick clock and publishes the world as both snapshots.
+    // Call after populating the world and before the first update() or start().
+    void reset();
+
+    // Runs every tick that is due by the clock
+    void update();
+
+    // Runs update() on a dedicated thread, sleeping until each tick is due
+    void start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Model matrices and models of every entity, interpolated for the
+    // clock's current time. The models stay alive while the caller holds
+    // them, even if the simulation has moved on. Safe to call from any thread.
+    void interpolate(std::vector<glm::dmat4>& matrices, std::vector<ModelRef>& models) const;
+
+    double getTickSeconds() const { return tickNs_ * 1e-9; }
+    uint64_t getTickCount() const { return tickCount_; }
+
+private:
+    // Transforms of every entity at the end of one tick
+    struct Snapshot {
+        Uint64 timeNs = 0;
+        std::vector<EntityId> ids;
+        std::vector<ModelRef> models;
+        std::vector<glm::dvec3> positions;
+        std::vector<glm::dvec3> rotations;
+        std::vector<glm::dvec3> scales;
+    };
+
+    void tick();
+    void publish(Uint64 timeNs);
+    void threadLoop();
+
+    Clock clock_;
+    Uint64 tickNs_;
+    Uint64 startNs_;                // Time of tick 0
+    std::atomic<uint64_t> tickCount_;
+
+    EntityStore world_;
+    TickFunction tickFunction_;
+
+    mutable std::mutex snapshotMutex_;
+    Snapshot previous_;
+    Snapshot current_;
+    Snapshot scratch_;              // Filled outside the lock, then swapped in
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+} // namespace SpaceGame
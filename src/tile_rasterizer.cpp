@@ -0,0 +1,266 @@
+#include "tile_rasterizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SPACEGAME_SSE2_FILL 1
+#include <emmintrin.h>
+#endif
+
+namespace SpaceGame {
+
+namespace {
+
+const uint32_t FACE_BIT = 0x80000000u;
+const int TILE_PIXELS = TileRasterizer::TILE_SIZE * TileRasterizer::TILE_SIZE;
+
+// Laid out as SDL_PIXELFORMAT_XRGB8888
+uint32_t packColor(const Color& c) {
+    return ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+// First pixel whose centre lies at or after edge, like SDL's geometry
+// rasteriser, clamped to [0, limit] before converting so faces projected far
+// off screen cannot overflow
+int firstPixel(float edge, int limit) {
+    return (int)std::min(std::max(std::ceil(edge - 0.5f), 0.0f), (float)limit);
+}
+
+// Pixel rectangle [x0, x1) x [y0, y1) covered by a primitive
+struct PixelRect {
+    int x0, y0, x1, y1;
+};
+
+PixelRect quadRect(const ScreenQuad& quad, int width, int height) {
+    float half = quad.size * 0.5f;
+    PixelRect rect = { firstPixel(quad.x - half, width), firstPixel(quad.y - half, height),
+                       firstPixel(quad.x + half, width), firstPixel(quad.y + half, height) };
+    // A voxel narrower than a pixel still covers the pixel under its centre,
+    // so distant ships do not break up into holes
+    if (rect.x1 == rect.x0 && quad.x >= 0.0f && quad.x < width) {
+        rect.x0 = (int)quad.x;
+        rect.x1 = rect.x0 + 1;
+    }
+    if (rect.y1 == rect.y0 && quad.y >= 0.0f && quad.y < height) {
+        rect.y0 = (int)quad.y;
+        rect.y1 = rect.y0 + 1;
+    }
+    return rect;
+}
+
+PixelRect faceRect(const ScreenFace& face, int width, int height) {
+    float minX = face.corners[0].x, maxX = minX;
+    float minY = face.corners[0].y, maxY = minY;
+    for (int c = 1; c < 4; ++c) {
+        minX = std::min(minX, face.corners[c].x);
+        maxX = std::max(maxX, face.corners[c].x);
+        minY = std::min(minY, face.corners[c].y);
+        maxY = std::max(maxY, face.corners[c].y);
+    }
+    return { firstPixel(minX, width), firstPixel(minY, height), firstPixel(maxX, width), firstPixel(maxY, height) };
+}
+
+// Fills count pixels of one row, keeping only those the span is nearer than
+void fillSpan(uint32_t* color, float* depth, int count, float spanDepth, uint32_t spanColor) {
+    int x = 0;
+#ifdef SPACEGAME_SSE2_FILL
+    const __m128 d = _mm_set1_ps(spanDepth);
+    const __m128i c = _mm_set1_epi32((int)spanColor);
+    for (; x + 4 <= count; x += 4) {
+        __m128 old = _mm_loadu_ps(depth + x);
+        __m128i nearer = _mm_castps_si128(_mm_cmplt_ps(d, old));
+        __m128i oldColor = _mm_loadu_si128((const __m128i*)(color + x));
+        _mm_storeu_ps(depth + x, _mm_min_ps(d, old));
+        _mm_storeu_si128((__m128i*)(color + x),
+                         _mm_or_si128(_mm_and_si128(nearer, c), _mm_andnot_si128(nearer, oldColor)));
+    }
+#endif
+    for (; x < count; ++x) {
+        if (spanDepth < depth[x]) {
+            depth[x] = spanDepth;
+            color[x] = spanColor;
+        }
+    }
+}
+
+// Twice the signed area of triangle abp; positive when p is left of ab
+// with y pointing down
+inline float edge(const SDL_FPoint& a, const SDL_FPoint& b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+// Fills the pixels of rect whose centres lie inside triangle abc, in either
+// winding, where each is nearer than the depth buffer. da, db and dc are the
+// corners' w; 1/w is linear in screen space, so it is interpolated from the
+// edge weights and inverted per pixel. rect is in screen pixels; color and
+// depth address the tile whose top-left pixel is (originX, originY).
+void fillTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, float da, float db, float dc,
+                  const PixelRect& rect, int originX, int originY,
+                  uint32_t* color, float* depth, uint32_t triangleColor) {
+    float area = edge(a, b, c.x, c.y);
+    if (std::abs(area) < 1e-6f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(b, c);
+        std::swap(db, dc);
+        area = -area;
+    }
+
+    // Edge weights over the area are barycentric coordinates, so scaling
+    // each corner's 1/w by 1/area gives 1/w at a pixel as a dot product
+    const float invA = 1.0f / (da * area), invB = 1.0f / (db * area), invC = 1.0f / (dc * area);
+    // Edge values step by a constant per pixel
+    const float stepX0 = -(c.y - b.y), stepX1 = -(a.y - c.y), stepX2 = -(b.y - a.y);
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        float py = y + 0.5f;
+        float px = rect.x0 + 0.5f;
+        float w0 = edge(b, c, px, py);
+        float w1 = edge(c, a, px, py);
+        float w2 = edge(a, b, px, py);
+        const int row = (y - originY) * TileRasterizer::TILE_SIZE - originX;
+        for (int x = rect.x0; x < rect.x1; ++x) {
+            if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+                float pixelDepth = 1.0f / (w0 * invA + w1 * invB + w2 * invC);
+                if (pixelDepth < depth[row + x]) {
+                    depth[row + x] = pixelDepth;
+                    color[row + x] = triangleColor;
+                }
+            }
+            w0 += stepX0;
+            w1 += stepX1;
+            w2 += stepX2;
+        }
+    }
+}
+
+} // namespace
+
+TileRasterizer::TileRasterizer() : width_(0), height_(0), tilesX_(0), tilesY_(0) {}
+
+void TileRasterizer::resize(int width, int height) {
+    if (width == width_ && height == height_) {
+        return;
+    }
+    width_ = width;
+    height_ = height;
+    tilesX_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+    color_.assign((size_t)getTileCount() * TILE_PIXELS, 0);
+    depth_.assign((size_t)getTileCount() * TILE_PIXELS, FLT_MAX);
+}
+
+void TileRasterizer::draw(const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+                          uint32_t clearColor, uint32_t* pixels, int pitch, int width, int height,
+                          JobSystem* jobs) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    resize(width, height);
+
+    // One slice of the primitives per thread, binned side by side
+    const size_t total = quads.size() + faces.size();
+    const size_t sliceCount = jobs ? (size_t)jobs->getThreadCount() : 1;
+    slices_.resize(sliceCount);
+    auto binSlices = [&](size_t begin, size_t end, int) {
+        for (size_t slice = begin; slice < end; ++slice) {
+            bin(quads, faces, total * slice / sliceCount, total * (slice + 1) / sliceCount, slices_[slice]);
+        }
+    };
+    auto drawTiles = [&](size_t begin, size_t end, int) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            drawTile((int)tile, quads, faces, clearColor, pixels, pitch);
+        }
+    };
+
+    if (jobs) {
+        jobs->parallelFor(sliceCount, 1, binSlices);
+        jobs->parallelFor((size_t)getTileCount(), 1, drawTiles);
+    } else {
+        binSlices(0, sliceCount, 0);
+        drawTiles(0, (size_t)getTileCount(), 0);
+    }
+}
+
+void TileRasterizer::bin(const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+                         size_t begin, size_t end, Bins& bins) const {
+    bins.tiles.resize(getTileCount());
+    for (auto& tile : bins.tiles) {
+        tile.clear();
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        PixelRect rect;
+        uint32_t index;
+        if (i < quads.size()) {
+            rect = quadRect(quads[i], width_, height_);
+            index = (uint32_t)i;
+        } else {
+            index = (uint32_t)(i - quads.size());
+            rect = faceRect(faces[index], width_, height_);
+            index |= FACE_BIT;
+        }
+        if (rect.x1 <= rect.x0 || rect.y1 <= rect.y0) {
+            continue;
+        }
+
+        int tileX1 = (rect.x1 - 1) / TILE_SIZE;
+        int tileY1 = (rect.y1 - 1) / TILE_SIZE;
+        for (int ty = rect.y0 / TILE_SIZE; ty <= tileY1; ++ty) {
+            for (int tx = rect.x0 / TILE_SIZE; tx <= tileX1; ++tx) {
+                bins.tiles[ty * tilesX_ + tx].push_back(index);
+            }
+        }
+    }
+}
+
+void TileRasterizer::drawTile(int tile, const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+                              uint32_t clearColor, uint32_t* pixels, int pitch) {
+    const int originX = (tile % tilesX_) * TILE_SIZE;
+    const int originY = (tile / tilesX_) * TILE_SIZE;
+    const int tileWidth = std::min(TILE_SIZE, width_ - originX);
+    const int tileHeight = std::min(TILE_SIZE, height_ - originY);
+    uint32_t* color = color_.data() + (size_t)tile * TILE_PIXELS;
+    float* depth = depth_.data() + (size_t)tile * TILE_PIXELS;
+
+    std::fill(color, color + TILE_PIXELS, clearColor);
+    std::fill(depth, depth + TILE_PIXELS, FLT_MAX);
+
+    const PixelRect bounds = { originX, originY, originX + tileWidth, originY + tileHeight };
+    for (const Bins& slice : slices_) {
+        for (uint32_t index : slice.tiles[tile]) {
+            if (index & FACE_BIT) {
+                const ScreenFace& face = faces[index & ~FACE_BIT];
+                PixelRect rect = faceRect(face, width_, height_);
+                rect = { std::max(rect.x0, bounds.x0), std::max(rect.y0, bounds.y0),
+                         std::min(rect.x1, bounds.x1), std::min(rect.y1, bounds.y1) };
+                uint32_t faceColor = packColor(face.color);
+                const float* d = face.cornerDepths;
+                fillTriangle(face.corners[0], face.corners[1], face.corners[2], d[0], d[1], d[2],
+                             rect, originX, originY, color, depth, faceColor);
+                fillTriangle(face.corners[0], face.corners[2], face.corners[3], d[0], d[2], d[3],
+                             rect, originX, originY, color, depth, faceColor);
+            } else {
+                const ScreenQuad& quad = quads[index];
+                PixelRect rect = quadRect(quad, width_, height_);
+                int x0 = std::max(rect.x0, bounds.x0);
+                int x1 = std::min(rect.x1, bounds.x1);
+                int y1 = std::min(rect.y1, bounds.y1);
+                uint32_t quadColor = packColor(quad.color);
+                for (int y = std::max(rect.y0, bounds.y0); y < y1; ++y) {
+                    int offset = (y - originY) * TILE_SIZE + (x0 - originX);
+                    fillSpan(color + offset, depth + offset, x1 - x0, quad.depth, quadColor);
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < tileHeight; ++y) {
+        uint32_t* row = (uint32_t*)((uint8_t*)pixels + (size_t)(originY + y) * pitch) + originX;
+        std::memcpy(row, color + y * TILE_SIZE, tileWidth * sizeof(uint32_t));
+    }
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "job_system.h"
+#include "transform_kernel.h"
+
+namespace SpaceGame {
+
+// Arbitrary screen-space quadrilateral produced from one greedy mesh face
+struct ScreenFace {
+    SDL_FPoint corners[4];
+    float cornerDepths[4];  // View-space distance (clip-space w) of each corner
+    float depth;    // Mean of cornerDepths, for the depth sort
+    Color color;    // Already shaded for the face direction
+};
+
+// Software rasteriser drawing projected voxel quads and mesh faces into a
+// 32-bit XRGB framebuffer, with its own depth buffer in place of a sort.
+// The screen is cut into square tiles. Primitives are first binned by the
+// tiles they touch, then each tile is cleared and drawn on its own job, so
+// threads never write the same pixel and no locking is needed. Voxel quads
+// are filled and depth tested four pixels at a time with SSE2.
+//
+// Mesh faces are depth tested per pixel, with w interpolated
+// perspective-correctly across the face; voxel quads are small and keep
+// their single depth. Alpha is ignored.
+class TileRasterizer {
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    TileRasterizer();
+
+    // Draws the primitives into pixels, pitch bytes per row, over a cleared
+    // width x height frame. Parallel over tiles when jobs is given.
+    void draw(const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+              uint32_t clearColor, uint32_t* pixels, int pitch, int width, int height,
+              JobSystem* jobs = nullptr);
+
+    int getTileCount() const { return tilesX_ * tilesY_; }
+
+private:
+    // Primitive indices per tile from one slice of the input. Faces carry
+    // FACE_BIT. Slices are binned in parallel but read back in order, so
+    // the draw order within a tile never depends on thread timing.
+    struct Bins {
+        std::vector<std::vector<uint32_t>> tiles;
+    };
+
+    void resize(int width, int height);
+    void bin(const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+             size_t begin, size_t end, Bins& bins) const;
+    // Clears and draws one tile in its own buffers, then copies it out, so
+    // the output is only ever written, once, in whole rows
+    void drawTile(int tile, const std::vector<ScreenQuad>& quads, const std::vector<ScreenFace>& faces,
+                  uint32_t clearColor, uint32_t* pixels, int pitch);
+
+    int width_, height_;
+    int tilesX_, tilesY_;
+    // TILE_SIZE x TILE_SIZE per tile, tile after tile, so a tile's pixels
+    // are contiguous for the thread drawing it
+    std::vector<uint32_t> color_;
+    std::vector<float> depth_;  // Nearest w per pixel
+    std::vector<Bins> slices_;
+};
+
+} // namespace SpaceGame
@@ -0,0 +1,244 @@
+#include "transform_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPACEGAME_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace SpaceGame {
+
+namespace {
+
+// Handles voxels [first, count) one at a time; also finishes the SIMD tails
+size_t transformScalar(const VoxelSoA& voxels, const TransformParams& p, ScreenQuad* out, size_t first) {
+    const float* m = p.mvp;
+    const float halfWidth = p.width * 0.5f;
+    const float halfHeight = p.height * 0.5f;
+    size_t written = 0;
+
+    for (size_t i = first; i < voxels.size(); ++i) {
+        float x = voxels.x[i];
+        float y = voxels.y[i];
+        float z = voxels.z[i];
+
+        float clipW = m[3] * x + m[7] * y + m[11] * z + m[15];
+        if (clipW <= 0.0f) {
+            continue;
+        }
+
+        float invW = 1.0f / clipW;
+        float depth = (m[2] * x + m[6] * y + m[10] * z + m[14]) * invW;
+        if (depth <= 0.0f || depth >= 1.0f) {
+            continue;
+        }
+
+        float sx = ((m[0] * x + m[4] * y + m[8] * z + m[12]) * invW + 1.0f) * halfWidth;
+        float sy = (1.0f - (m[1] * x + m[5] * y + m[9] * z + m[13]) * invW) * halfHeight;
+        float size = p.pixelScale * invW;
+        float half = size * 0.5f;
+        if (sx + half < 0.0f || sx - half > p.width || sy + half < 0.0f || sy - half > p.height) {
+            continue;
+        }
+
+        out[written++] = { sx, sy, size, clipW, voxels.color[i] };
+    }
+    return written;
+}
+
+#ifdef SPACEGAME_X86_KERNELS
+
+// Four lanes of the projection; returns the visibility mask and leaves the
+// per-lane results in the output registers
+inline int projectLanesSSE2(__m128 x, __m128 y, __m128 z, const TransformParams& p,
+                            __m128& sx, __m128& sy, __m128& size, __m128& w) {
+    const float* m = p.mvp;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 halfWidth = _mm_set1_ps(p.width * 0.5f);
+    const __m128 halfHeight = _mm_set1_ps(p.height * 0.5f);
+
+    #define ROW(r) _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[r]), x), _mm_mul_ps(_mm_set1_ps(m[4 + r]), y)), \
+                              _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8 + r]), z), _mm_set1_ps(m[12 + r])))
+    __m128 cx = ROW(0);
+    __m128 cy = ROW(1);
+    __m128 cz = ROW(2);
+    w = ROW(3);
+    #undef ROW
+
+    __m128 invW = _mm_div_ps(one, w);
+    __m128 depth = _mm_mul_ps(cz, invW);
+    sx = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, invW), one), halfWidth);
+    sy = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(cy, invW)), halfHeight);
+    size = _mm_mul_ps(_mm_set1_ps(p.pixelScale), invW);
+    __m128 half = _mm_mul_ps(size, _mm_set1_ps(0.5f));
+
+    __m128 visible = _mm_and_ps(_mm_cmpgt_ps(w, zero), _mm_cmpgt_ps(depth, zero));
+    visible = _mm_and_ps(visible, _mm_cmplt_ps(depth, one));
+    visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(sx, half), zero));
+    visible = _mm_and_ps(visible, _mm_cmple_ps(_mm_sub_ps(sx, half), _mm_set1_ps(p.width)));
+    visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(sy, half), zero));
+    visible = _mm_and_ps(visible, _mm_cmple_ps(_mm_sub_ps(sy, half), _mm_set1_ps(p.height)));
+    return _mm_movemask_ps(visible);
+}
+
+// Writes the lanes selected by mask, lowest first
+inline size_t emitLanes(int mask, const float* sx, const float* sy, const float* size, const float* w,
+                        const Color* colors, ScreenQuad* out) {
+    size_t written = 0;
+    while (mask) {
+        int lane = __builtin_ctz((unsigned)mask);
+        out[written++] = { sx[lane], sy[lane], size[lane], w[lane], colors[lane] };
+        mask &= mask - 1;
+    }
+    return written;
+}
+
+size_t transformSSE2(const VoxelSoA& voxels, const TransformParams& p, ScreenQuad* out) {
+    const size_t count = voxels.size();
+    const size_t blocks = count & ~(size_t)7;
+    size_t written = 0;
+    alignas(16) float sx[8], sy[8], size[8], w[8];
+
+    for (size_t i = 0; i < blocks; i += 8) {
+        __m128i x16 = _mm_loadu_si128((const __m128i*)(voxels.x.data() + i));
+        __m128i y16 = _mm_loadu_si128((const __m128i*)(voxels.y.data() + i));
+        __m128i z16 = _mm_loadu_si128((const __m128i*)(voxels.z.data() + i));
+
+        // Sign-extend each int16 half to int32 by unpacking into the high word
+        int mask = 0;
+        for (int half = 0; half < 2; ++half) {
+            __m128i xi = half ? _mm_unpackhi_epi16(x16, x16) : _mm_unpacklo_epi16(x16, x16);
+            __m128i yi = half ? _mm_unpackhi_epi16(y16, y16) : _mm_unpacklo_epi16(y16, y16);
+            __m128i zi = half ? _mm_unpackhi_epi16(z16, z16) : _mm_unpacklo_epi16(z16, z16);
+            __m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(xi, 16));
+            __m128 y = _mm_cvtepi32_ps(_mm_srai_epi32(yi, 16));
+            __m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(zi, 16));
+
+            __m128 vx, vy, vsize, vw;
+            mask |= projectLanesSSE2(x, y, z, p, vx, vy, vsize, vw) << (half * 4);
+            _mm_store_ps(sx + half * 4, vx);
+            _mm_store_ps(sy + half * 4, vy);
+            _mm_store_ps(size + half * 4, vsize);
+            _mm_store_ps(w + half * 4, vw);
+        }
+
+        if (mask) {
+            written += emitLanes(mask, sx, sy, size, w, voxels.color.data() + i, out + written);
+        }
+    }
+
+    return written + transformScalar(voxels, p, out + written, blocks);
+}
+
+__attribute__((target("avx2")))
+size_t transformAVX2(const VoxelSoA& voxels, const TransformParams& p, ScreenQuad* out) {
+    const float* m = p.mvp;
+    const size_t count = voxels.size();
+    const size_t blocks = count & ~(size_t)7;
+    size_t written = 0;
+    alignas(32) float sx[8], sy[8], size[8], w[8];
+
+    __m256 col[16];
+    for (int i = 0; i < 16; ++i) {
+        col[i] = _mm256_set1_ps(m[i]);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 halfWidth = _mm256_set1_ps(p.width * 0.5f);
+    const __m256 halfHeight = _mm256_set1_ps(p.height * 0.5f);
+    const __m256 width = _mm256_set1_ps(p.width);
+    const __m256 height = _mm256_set1_ps(p.height);
+    const __m256 pixelScale = _mm256_set1_ps(p.pixelScale);
+    const __m256 halfScale = _mm256_set1_ps(0.5f);
+
+    for (size_t i = 0; i < blocks; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(voxels.x.data() + i))));
+        __m256 y = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(voxels.y.data() + i))));
+        __m256 z = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(voxels.z.data() + i))));
+
+        #define ROW(r) _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(col[r], x), _mm256_mul_ps(col[4 + r], y)), \
+                                     _mm256_add_ps(_mm256_mul_ps(col[8 + r], z), col[12 + r]))
+        __m256 cx = ROW(0);
+        __m256 cy = ROW(1);
+        __m256 cz = ROW(2);
+        __m256 cw = ROW(3);
+        #undef ROW
+
+        __m256 invW = _mm256_div_ps(one, cw);
+        __m256 depth = _mm256_mul_ps(cz, invW);
+        __m256 vx = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, invW), one), halfWidth);
+        __m256 vy = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(cy, invW)), halfHeight);
+        __m256 vsize = _mm256_mul_ps(pixelScale, invW);
+        __m256 half = _mm256_mul_ps(vsize, halfScale);
+
+        __m256 visible = _mm256_and_ps(_mm256_cmp_ps(cw, zero, _CMP_GT_OQ), _mm256_cmp_ps(depth, zero, _CMP_GT_OQ));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(depth, one, _CMP_LT_OQ));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(vx, half), zero, _CMP_GE_OQ));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_sub_ps(vx, half), width, _CMP_LE_OQ));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(vy, half), zero, _CMP_GE_OQ));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_sub_ps(vy, half), height, _CMP_LE_OQ));
+
+        int mask = _mm256_movemask_ps(visible);
+        if (mask) {
+            _mm256_store_ps(sx, vx);
+            _mm256_store_ps(sy, vy);
+            _mm256_store_ps(size, vsize);
+            _mm256_store_ps(w, cw);
+            written += emitLanes(mask, sx, sy, size, w, voxels.color.data() + i, out + written);
+        }
+    }
+
+    return written + transformScalar(voxels, p, out + written, blocks);
+}
+
+#endif // SPACEGAME_X86_KERNELS
+
+KernelPath detectKernelPath() {
+#ifdef SPACEGAME_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelPath::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return KernelPath::SSE2;
+    }
+#endif
+    return KernelPath::Scalar;
+}
+
+const KernelPath bestPath = detectKernelPath();
+KernelPath currentPath = bestPath;
+
+} // namespace
+
+KernelPath getBestKernelPath() {
+    return bestPath;
+}
+
+void setKernelPath(KernelPath path) {
+    currentPath = (int)path > (int)bestPath ? bestPath : path;
+}
+
+KernelPath getKernelPath() {
+    return currentPath;
+}
+
+const char* getKernelPathName(KernelPath path) {
+    switch (path) {
+        case KernelPath::SSE2: return "sse2";
+        case KernelPath::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+size_t transformVoxels(const VoxelSoA& voxels, const TransformParams& params, ScreenQuad* out) {
+    switch (currentPath) {
+#ifdef SPACEGAME_X86_KERNELS
+        case KernelPath::AVX2: return transformAVX2(voxels, params, out);
+        case KernelPath::SSE2: return transformSSE2(voxels, params, out);
+#endif
+        default: return transformScalar(voxels, params, out, 0);
+    }
+}
+
+} // namespace SpaceGame
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "voxel.h"
+
+namespace SpaceGame {
+
+// Screen-space square produced by the projection stage for a single voxel
+struct ScreenQuad {
+    float x, y;     // Center in pixels
+    float size;     // Edge length in pixels
+    float depth;    // View-space distance (clip-space w)
+    Color color;
+};
+
+// Constants shared by every voxel of one ship
+struct TransformParams {
+    // Column-major model-view-projection matrix. Built in double precision
+    // and narrowed afterwards, so it maps small ship-relative coordinates
+    // and float precision holds regardless of where the ship is.
+    float mvp[16];
+    float width, height;    // Output size in pixels
+    float pixelScale;       // Pixels covered by a unit voxel at w = 1
+};
+
+enum class KernelPath {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Best path the running CPU supports, detected once at startup
+KernelPath getBestKernelPath();
+
+// Path used by transformVoxels; requests above getBestKernelPath() are clamped
+void setKernelPath(KernelPath path);
+KernelPath getKernelPath();
+const char* getKernelPathName(KernelPath path);
+
+// Projects the voxels eight at a time, doing the perspective divide and
+// rejecting voxels behind the camera, outside the depth range or off
+// screen. Survivors are written to out, which must have room for
+// voxels.size() entries. Returns the number written.
+size_t transformVoxels(const VoxelSoA& voxels, const TransformParams& params, ScreenQuad* out);
+
+} // namespace SpaceGame
@@ -1,109 +1,897 @@
 #include "voxel.h"
+#include "mesher.h"
+#include "lod.h"
+#include "mapped_file.h"
+#include "compressed_model.h"
+#include "job_system.h"
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 #include <algorithm>
 
 namespace SpaceGame {
 
-VoxelModel::VoxelModel() {}
+void Voxel::setHealth(double value) {
+    value = std::min(std::max(value, 0.0), 1.0);
+    health = (uint8_t)std::lround(value * MAX_HEALTH);
+}
+
+void VoxelSoA::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    color.clear();
+}
+
+void VoxelSoA::reserve(size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    z.reserve(count);
+    color.reserve(count);
+}
+
+void VoxelSoA::push_back(const Voxel& voxel) {
+    x.push_back(voxel.x);
+    y.push_back(voxel.y);
+    z.push_back(voxel.z);
+    color.push_back(voxel.color);
+}
+
+size_t VoxelSoA::getMemoryUsage() const {
+    return (x.capacity() + y.capacity() + z.capacity()) * sizeof(int16_t)
+        + color.capacity() * sizeof(Color);
+}
+
+VoxelModel::VoxelModel()
+    : soaDirty_(true),
+      lodsDirty_(true),
+      boundsDirty_(true),
+      boundsMin_(0, 0, 0),
+      boundsMax_(0, 0, 0),
+      sphereCenter_(0, 0, 0),
+      sphereRadius_(0.0) {}
 
 void VoxelModel::addVoxel(const Voxel& voxel) {
-    if (!voxel.isEmpty()) {
+    if (voxel.isEmpty()) {
+        return;
+    }
+    soaDirty_ = true;
+    lodsDirty_ = true;
+
+    uint32_t slot = index_.find(voxel.x, voxel.y, voxel.z);
+    if (slot != VoxelIndex::NONE) {
+        voxels_[slot] = voxel;
+    } else {
+        index_.insert(voxel.x, voxel.y, voxel.z, (uint32_t)voxels_.size());
         voxels_.push_back(voxel);
     }
+    touch(voxel.x, voxel.y, voxel.z);
 }
 
 void VoxelModel::removeVoxel(int16_t x, int16_t y, int16_t z) {
-    auto it = std::remove_if(voxels_.begin(), voxels_.end(),
-        [x, y, z](const Voxel& v) {
-            return v.x == x && v.y == y && v.z == z;
-        });
-    voxels_.erase(it, voxels_.end());
+    if (erase(x, y, z)) {
+        lodsDirty_ = true;
+    }
+}
+
+bool VoxelModel::erase(int16_t x, int16_t y, int16_t z) {
+    uint32_t slot = index_.find(x, y, z);
+    if (slot == VoxelIndex::NONE) {
+        return false;
+    }
+
+    index_.erase(x, y, z);
+    touch(x, y, z);
+    soaDirty_ = true;
+
+    // Move the last voxel into the freed slot
+    uint32_t last = (uint32_t)voxels_.size() - 1;
+    if (slot != last) {
+        const Voxel& moved = voxels_[last];
+        voxels_[slot] = moved;
+        index_.insert(moved.x, moved.y, moved.z, slot);
+    }
+    voxels_.pop_back();
+    return true;
 }
 
 const Voxel* VoxelModel::getVoxel(int16_t x, int16_t y, int16_t z) const {
-    for (const auto& voxel : voxels_) {
-        if (voxel.x == x && voxel.y == y && voxel.z == z) {
-            return &voxel;
+    uint32_t slot = index_.find(x, y, z);
+    if (slot == VoxelIndex::NONE) {
+        return nullptr;
+    }
+    return &voxels_[slot];
+}
+
+void VoxelModel::clear() {
+    voxels_.clear();
+    index_.clear();
+    surface_.clear();
+    mesh_.clear();
+    occupancy_.clear();
+    soaDirty_ = true;
+    lodsDirty_ = true;
+    boundsDirty_ = true;
+}
+
+void VoxelModel::touch(int16_t x, int16_t y, int16_t z) {
+    index_.touch(x, y, z);
+    boundsDirty_ = true;
+
+    // Neighbours in other bricks may have gained or lost an exposed face
+    int lx = x & VoxelIndex::BRICK_MASK;
+    int ly = y & VoxelIndex::BRICK_MASK;
+    int lz = z & VoxelIndex::BRICK_MASK;
+    if (lx == 0) index_.touch(x - 1, y, z);
+    if (lx == VoxelIndex::BRICK_MASK) index_.touch(x + 1, y, z);
+    if (ly == 0) index_.touch(x, y - 1, z);
+    if (ly == VoxelIndex::BRICK_MASK) index_.touch(x, y + 1, z);
+    if (lz == 0) index_.touch(x, y, z - 1);
+    if (lz == VoxelIndex::BRICK_MASK) index_.touch(x, y, z + 1);
+}
+
+const VoxelSoA& VoxelModel::getSoA() const {
+    if (soaDirty_) {
+        soa_.clear();
+        soa_.reserve(voxels_.size());
+        for (const auto& voxel : voxels_) {
+            soa_.push_back(voxel);
+        }
+        soaDirty_ = false;
+    }
+    return soa_;
+}
+
+const std::vector<SurfaceBrick>& VoxelModel::getSurface() const {
+    const auto& bricks = index_.getBricks();
+    surface_.resize(bricks.size());
+
+    for (size_t i = 0; i < bricks.size(); ++i) {
+        if (surface_[i].revision != bricks[i].revision) {
+            buildSurfaceBrick(bricks[i], surface_[i]);
         }
     }
-    return nullptr;
+    return surface_;
 }
 
-void VoxelModel::getBounds(glm::vec3& min, glm::vec3& max) const {
+size_t VoxelModel::getSurfaceVoxelCount() const {
+    size_t count = 0;
+    for (const auto& brick : getSurface()) {
+        count += brick.voxels.size();
+    }
+    return count;
+}
+
+void VoxelModel::buildSurfaceBrick(const VoxelIndex::Brick& brick, SurfaceBrick& surface) const {
+    surface.voxels.clear();
+    surface.revision = brick.revision;
+    if (brick.count == 0) {
+        return;
+    }
+
+    for (uint32_t slot : brick.slots) {
+        if (slot == VoxelIndex::NONE) {
+            continue;
+        }
+
+        const Voxel& v = voxels_[slot];
+        bool enclosed = isOccupied(v.x - 1, v.y, v.z) && isOccupied(v.x + 1, v.y, v.z)
+                     && isOccupied(v.x, v.y - 1, v.z) && isOccupied(v.x, v.y + 1, v.z)
+                     && isOccupied(v.x, v.y, v.z - 1) && isOccupied(v.x, v.y, v.z + 1);
+        if (!enclosed) {
+            surface.voxels.push_back(v);
+        }
+    }
+
+    // Extremal voxels always have an exposed face, so the surface alone
+    // gives the brick's bounds
+    const VoxelSoA& soa = surface.voxels;
+    if (soa.size() > 0) {
+        glm::dvec3 lo(soa.x[0], soa.y[0], soa.z[0]);
+        glm::dvec3 hi = lo;
+        for (size_t i = 1; i < soa.size(); ++i) {
+            glm::dvec3 p(soa.x[i], soa.y[i], soa.z[i]);
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        surface.boundsMin = lo - 0.5;
+        surface.boundsMax = hi + 0.5;
+    }
+}
+
+const std::vector<BrickMesh>& VoxelModel::getMesh() const {
+    const auto& bricks = index_.getBricks();
+    mesh_.resize(bricks.size());
+
+    for (size_t i = 0; i < bricks.size(); ++i) {
+        if (mesh_[i].revision != bricks[i].revision) {
+            meshBrick(*this, bricks[i], mesh_[i]);
+        }
+    }
+    return mesh_;
+}
+
+const std::vector<BrickOccupancy>& VoxelModel::getOccupancy() const {
+    const auto& bricks = index_.getBricks();
+    occupancy_.resize(bricks.size());
+
+    for (size_t i = 0; i < bricks.size(); ++i) {
+        BrickOccupancy& occupancy = occupancy_[i];
+        if (occupancy.revision == bricks[i].revision) {
+            continue;
+        }
+        occupancy.revision = bricks[i].revision;
+        for (int word = 0; word < BrickOccupancy::WORDS; ++word) {
+            uint64_t bits = 0;
+            for (int bit = 0; bit < 64; ++bit) {
+                if (bricks[i].slots[word * 64 + bit] != VoxelIndex::NONE) {
+                    bits |= 1ull << bit;
+                }
+            }
+            occupancy.bits[word] = bits;
+        }
+    }
+    return occupancy_;
+}
+
+MeshStats VoxelModel::getMeshStats() const {
+    MeshStats stats;
+    for (const auto& brick : getMesh()) {
+        stats.faces += brick.faces;
+        stats.quads += brick.quads.size();
+    }
+    return stats;
+}
+
+MemoryFootprint VoxelModel::getMemoryFootprint() const {
+    MemoryFootprint footprint;
+    footprint.voxels = voxels_.capacity() * sizeof(Voxel);
+    footprint.index = index_.getMemoryUsage();
+    footprint.soa = soa_.getMemoryUsage();
+    footprint.surface = surface_.capacity() * sizeof(SurfaceBrick);
+    for (const auto& brick : surface_) {
+        footprint.surface += brick.voxels.getMemoryUsage();
+    }
+    footprint.mesh = mesh_.capacity() * sizeof(BrickMesh);
+    for (const auto& brick : mesh_) {
+        footprint.mesh += brick.quads.capacity() * sizeof(MeshQuad);
+    }
+    footprint.occupancy = occupancy_.capacity() * sizeof(BrickOccupancy);
+    for (const auto& lod : lods_) {
+        footprint.lod += lod->getMemoryFootprint().total();
+    }
+    return footprint;
+}
+
+const VoxelModel& VoxelModel::getLod(int level) const {
+    if (lodsDirty_) {
+        lods_.clear();
+        lodsDirty_ = false;
+    }
+
+    level = std::min(std::max(level, 0), MAX_LOD_LEVELS - 1);
+    while ((int)lods_.size() < level) {
+        auto next = std::make_shared<VoxelModel>();
+        downsample(lods_.empty() ? *this : *lods_.back(), *next);
+        lods_.push_back(std::move(next));
+    }
+    return level == 0 ? *this : *lods_[level - 1];
+}
+
+void VoxelModel::getBounds(glm::dvec3& min, glm::dvec3& max) const {
+    updateBounds();
+    min = boundsMin_;
+    max = boundsMax_;
+}
+
+void VoxelModel::getBoundingSphere(glm::dvec3& center, double& radius) const {
+    updateBounds();
+    center = sphereCenter_;
+    radius = sphereRadius_;
+}
+
+void VoxelModel::updateBounds() const {
+    if (!boundsDirty_) {
+        return;
+    }
+    boundsDirty_ = false;
+
+    bool empty = true;
+    for (const auto& brick : getSurface()) {
+        if (brick.voxels.size() == 0) {
+            continue;
+        }
+        if (empty) {
+            boundsMin_ = brick.boundsMin;
+            boundsMax_ = brick.boundsMax;
+            empty = false;
+        } else {
+            boundsMin_ = glm::min(boundsMin_, brick.boundsMin);
+            boundsMax_ = glm::max(boundsMax_, brick.boundsMax);
+        }
+    }
+
+    if (empty) {
+        boundsMin_ = boundsMax_ = sphereCenter_ = glm::dvec3(0, 0, 0);
+        sphereRadius_ = 0.0;
+        return;
+    }
+    sphereCenter_ = (boundsMin_ + boundsMax_) * 0.5;
+    sphereRadius_ = glm::length(boundsMax_ - sphereCenter_);
+}
+
+namespace {
+
+// 3D-DDA over a grid of cubes `size` voxels wide, where cell c spans
+// [c * size - 0.5, (c + 1) * size - 0.5] so that size 1 gives voxel cells
+// and BRICK_SIZE gives brick cells
+struct GridWalk {
+    int cell[3];
+    int step[3];
+    double tNext[3];    // Ray parameter at the next boundary on each axis
+    double tDelta[3];   // Ray parameter between boundaries on each axis
+    double t;           // Ray parameter where the current cell was entered
+    int axis;           // Axis crossed to enter the current cell
+
+    GridWalk(const glm::dvec3& origin, const glm::dvec3& direction, int size,
+             const int start[3], double tStart, int enterAxis)
+        : t(tStart), axis(enterAxis) {
+        for (int a = 0; a < 3; ++a) {
+            cell[a] = start[a];
+            if (direction[a] > 0.0) {
+                step[a] = 1;
+                tDelta[a] = size / direction[a];
+                tNext[a] = ((cell[a] + 1) * size - 0.5 - origin[a]) / direction[a];
+            } else if (direction[a] < 0.0) {
+                step[a] = -1;
+                tDelta[a] = -size / direction[a];
+                tNext[a] = (cell[a] * size - 0.5 - origin[a]) / direction[a];
+            } else {
+                step[a] = 0;
+                tDelta[a] = tNext[a] = INFINITY;
+            }
+        }
+    }
+
+    void advance() {
+        axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        t = tNext[axis];
+        cell[axis] += step[axis];
+        tNext[axis] += tDelta[axis];
+    }
+};
+
+} // namespace
+
+bool VoxelModel::raycast(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                         RayHit& hit) const {
+    glm::dvec3 boundsMin, boundsMax;
+    getBounds(boundsMin, boundsMax);
     if (voxels_.empty()) {
-        min = max = glm::vec3(0, 0, 0);
+        return false;
+    }
+
+    // Clip the ray to the model's box so the walk never visits empty space
+    // outside it
+    double tEnter = 0.0;
+    double tExit = maxDistance;
+    int enterAxis = -1;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (direction[axis] == 0.0) {
+            if (origin[axis] < boundsMin[axis] || origin[axis] > boundsMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+        double t0 = (boundsMin[axis] - origin[axis]) / direction[axis];
+        double t1 = (boundsMax[axis] - origin[axis]) / direction[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enterAxis = axis;
+        }
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) {
+        return false;
+    }
+
+    // Starting inside the box counts as entering against the main direction
+    if (enterAxis < 0) {
+        glm::dvec3 size = glm::abs(direction);
+        enterAxis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+    }
+
+    // Voxel range of the bounds; rounding can put an entry point a hair
+    // outside it, so cells are clamped into it
+    const int shift = VoxelIndex::BRICK_SHIFT;
+    int lo[3], hi[3], start[3], brickStart[3];
+    glm::dvec3 entry = origin + direction * tEnter;
+    for (int axis = 0; axis < 3; ++axis) {
+        lo[axis] = (int)std::lround(boundsMin[axis] + 0.5);
+        hi[axis] = (int)std::lround(boundsMax[axis] - 0.5);
+        start[axis] = std::min(std::max((int)std::floor(entry[axis] + 0.5), lo[axis]), hi[axis]);
+        brickStart[axis] = start[axis] >> shift;
+    }
+
+    // Walk bricks, and voxels only inside bricks that hold any
+    const auto& bricks = index_.getBricks();
+    GridWalk outer(origin, direction, VoxelIndex::BRICK_SIZE, brickStart, tEnter, enterAxis);
+    bool first = true;
+    while (true) {
+        uint32_t b = index_.findBrick((int16_t)outer.cell[0], (int16_t)outer.cell[1], (int16_t)outer.cell[2]);
+        if (b != VoxelIndex::NONE && bricks[b].count > 0) {
+            const VoxelIndex::Brick& brick = bricks[b];
+            int cellLo[3], cellHi[3], cell[3];
+            glm::dvec3 point = origin + direction * outer.t;
+            for (int axis = 0; axis < 3; ++axis) {
+                cellLo[axis] = std::max(outer.cell[axis] << shift, lo[axis]);
+                cellHi[axis] = std::min((outer.cell[axis] << shift) | VoxelIndex::BRICK_MASK, hi[axis]);
+                int c = first ? start[axis] : (int)std::floor(point[axis] + 0.5);
+                cell[axis] = std::min(std::max(c, cellLo[axis]), cellHi[axis]);
+            }
+
+            GridWalk inner(origin, direction, 1, cell, outer.t, outer.axis);
+            while (true) {
+                uint32_t slot = brick.slots[VoxelIndex::cellIndex((int16_t)inner.cell[0], (int16_t)inner.cell[1],
+                                                                  (int16_t)inner.cell[2])];
+                if (slot != VoxelIndex::NONE) {
+                    hit.x = (int16_t)inner.cell[0];
+                    hit.y = (int16_t)inner.cell[1];
+                    hit.z = (int16_t)inner.cell[2];
+                    hit.face = (uint8_t)(inner.axis * 2 + (inner.step[inner.axis] > 0 ? 0 : 1));
+                    hit.distance = inner.t;
+                    return true;
+                }
+                inner.advance();
+                int a = inner.axis;
+                if (inner.t > tExit || inner.cell[a] < cellLo[a] || inner.cell[a] > cellHi[a]) {
+                    break;
+                }
+            }
+        }
+
+        first = false;
+        outer.advance();
+        int a = outer.axis;
+        if (outer.t > tExit || outer.cell[a] < lo[a] >> shift || outer.cell[a] > hi[a] >> shift) {
+            return false;
+        }
+    }
+}
+
+size_t VoxelModel::raycast(const Ray* rays, size_t count, RayHit* hits, bool* found, JobSystem* jobs) const {
+    // Build the bounds up front; after that every query only reads
+    updateBounds();
+
+    std::atomic<size_t> total(0);
+    auto run = [&](size_t begin, size_t end, int) {
+        size_t local = 0;
+        for (size_t i = begin; i < end; ++i) {
+            found[i] = raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+            local += found[i];
+        }
+        total += local;
+    };
+
+    if (jobs) {
+        jobs->parallelFor(count, 256, run);
+    } else {
+        run(0, count, 0);
+    }
+    return total;
+}
+
+DamageResult VoxelModel::applyBlast(const glm::dvec3& center, double radius, double damage) {
+    DamageResult result;
+    if (radius <= 0.0 || damage <= 0.0) {
+        return result;
+    }
+
+    glm::dvec3 lo = glm::ceil(center - radius);
+    glm::dvec3 hi = glm::floor(center + radius);
+    int minCell[3], maxCell[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        minCell[axis] = (int)std::max(lo[axis], (double)INT16_MIN);
+        maxCell[axis] = (int)std::min(hi[axis], (double)INT16_MAX);
+        if (minCell[axis] > maxCell[axis]) {
+            return result;
+        }
+    }
+
+    std::vector<Voxel> changed;
+    std::vector<Voxel> destroyed;
+    const double peak = damage * Voxel::MAX_HEALTH;
+    const auto& bricks = index_.getBricks();
+
+    // Visit only the bricks overlapping the blast's box, and in each only
+    // the cells inside it
+    const int shift = VoxelIndex::BRICK_SHIFT;
+    for (int bz = minCell[2] >> shift; bz <= maxCell[2] >> shift; ++bz) {
+        for (int by = minCell[1] >> shift; by <= maxCell[1] >> shift; ++by) {
+            for (int bx = minCell[0] >> shift; bx <= maxCell[0] >> shift; ++bx) {
+                uint32_t b = index_.findBrick((int16_t)bx, (int16_t)by, (int16_t)bz);
+                if (b == VoxelIndex::NONE || bricks[b].count == 0) {
+                    continue;
+                }
+                const VoxelIndex::Brick& brick = bricks[b];
+                int x0 = std::max(minCell[0], bx << shift), x1 = std::min(maxCell[0], (bx << shift) | VoxelIndex::BRICK_MASK);
+                int y0 = std::max(minCell[1], by << shift), y1 = std::min(maxCell[1], (by << shift) | VoxelIndex::BRICK_MASK);
+                int z0 = std::max(minCell[2], bz << shift), z1 = std::min(maxCell[2], (bz << shift) | VoxelIndex::BRICK_MASK);
+
+                for (int z = z0; z <= z1; ++z) {
+                    for (int y = y0; y <= y1; ++y) {
+                        for (int x = x0; x <= x1; ++x) {
+                            uint32_t slot = brick.slots[VoxelIndex::cellIndex((int16_t)x, (int16_t)y, (int16_t)z)];
+                            if (slot == VoxelIndex::NONE) {
+                                continue;
+                            }
+                            double distance = glm::length(glm::dvec3(x, y, z) - center);
+                            if (distance > radius) {
+                                continue;
+                            }
+                            int amount = (int)std::lround(peak * (1.0 - distance / radius));
+                            if (amount > 0) {
+                                damageSlot(slot, amount, result, changed, destroyed);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    finishDamage(changed, destroyed);
+    return result;
+}
+
+DamageResult VoxelModel::applyRayHit(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                                     double damage, RayHit* hit) {
+    DamageResult result;
+    RayHit found;
+    if (!raycast(origin, direction, maxDistance, found)) {
+        return result;
+    }
+    if (hit) {
+        *hit = found;
+    }
+
+    int amount = (int)std::lround(std::max(damage, 0.0) * Voxel::MAX_HEALTH);
+    if (amount > 0) {
+        std::vector<Voxel> changed;
+        std::vector<Voxel> destroyed;
+        damageSlot(index_.find(found.x, found.y, found.z), amount, result, changed, destroyed);
+        finishDamage(changed, destroyed);
+    }
+    return result;
+}
+
+void VoxelModel::damageSlot(uint32_t slot, int amount, DamageResult& result,
+                            std::vector<Voxel>& changed, std::vector<Voxel>& destroyed) {
+    // Health feeds no cached render data, so surviving voxels need no touch
+    Voxel& v = voxels_[slot];
+    if (amount >= v.health) {
+        v.health = 0;
+        destroyed.push_back(v);
+        result.destroyed++;
+    } else {
+        v.health = (uint8_t)(v.health - amount);
+        result.damaged++;
+    }
+    changed.push_back(v);
+}
+
+void VoxelModel::finishDamage(const std::vector<Voxel>& changed, const std::vector<Voxel>& destroyed) {
+    for (const Voxel& v : destroyed) {
+        erase(v.x, v.y, v.z);
+    }
+    if (changed.empty() || lodsDirty_ || lods_.empty()) {
         return;
     }
 
-    min.x = max.x = voxels_[0].x;
-    min.y = max.y = voxels_[0].y;
-    min.z = max.z = voxels_[0].z;
+    // Each level's voxels depend only on their 2x2x2 children, so recompute
+    // just the parents of what changed, level by level
+    std::vector<std::array<int16_t, 3>> cells;
+    cells.reserve(changed.size());
+    for (const Voxel& v : changed) {
+        cells.push_back({ v.x, v.y, v.z });
+    }
+
+    for (size_t level = 0; level < lods_.size(); ++level) {
+        for (auto& cell : cells) {
+            cell = { (int16_t)(cell[0] >> 1), (int16_t)(cell[1] >> 1), (int16_t)(cell[2] >> 1) };
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        // A copy of this model may still share the level; leave it theirs.
+        // Levels are always created as mutable VoxelModels, so editing one
+        // nobody else holds is safe.
+        if (lods_[level].use_count() > 1) {
+            lods_[level] = std::make_shared<VoxelModel>(*lods_[level]);
+        }
+        VoxelModel& lod = const_cast<VoxelModel&>(*lods_[level]);
+        const VoxelModel& source = level == 0 ? *this : *lods_[level - 1];
+
+        for (const auto& cell : cells) {
+            Voxel merged;
+            if (!downsampleBlock(source, cell[0], cell[1], cell[2], merged)) {
+                lod.erase(cell[0], cell[1], cell[2]);
+                continue;
+            }
+            uint32_t slot = lod.index_.find(cell[0], cell[1], cell[2]);
+            Voxel* existing = slot != VoxelIndex::NONE ? &lod.voxels_[slot] : nullptr;
+            if (existing && existing->type == merged.type && existing->color.r == merged.color.r &&
+                existing->color.g == merged.color.g && existing->color.b == merged.color.b &&
+                existing->color.a == merged.color.a) {
+                existing->health = merged.health;
+            } else {
+                lod.addVoxel(merged);
+            }
+        }
+    }
+}
+
+// File formats
+//
+// v1 (legacy, no header):
+//   uint32_t count, then per voxel x, y, z (int16), type, r, g, b, a (uint8)
+//   and health as a double (19 bytes) or, in older files, a float (15 bytes).
+//
+// v2:
+//   24-byte header: "SGVX", uint16_t version, uint16_t record size,
+//   uint32_t endian marker, uint32_t count, uint32_t checksum, uint32_t 0
+//   followed by count packed Voxel records, identical to the in-memory layout.
+//   The checksum is FNV-1a over the records read as little-endian uint32s.
+//
+// v3:
+//   The v2 header with record size 0, followed by the serialized
+//   CompressedVoxelModel (palette and run-length encoded bricks). count is
+//   the number of voxels and the checksum covers the whole payload.
+
+namespace {
+
+const char FILE_MAGIC[4] = { 'S', 'G', 'V', 'X' };
+const uint16_t FILE_VERSION = 2;
+const uint16_t FILE_VERSION_COMPRESSED = 3;
+const uint32_t ENDIAN_MARKER = 0x01020304u;
+const size_t HEADER_SIZE = 24;
+
+bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
 
-    for (const auto& voxel : voxels_) {
-        min.x = std::min(min.x, static_cast<float>(voxel.x));
-        min.y = std::min(min.y, static_cast<float>(voxel.y));
-        min.z = std.min(min.z, static_cast<float>(voxel.z));
-        max.x = std::max(max.x, static_cast<float>(voxel.x));
-        max.y = std::max(max.y, static_cast<float>(voxel.y));
-        max.z = std::max(max.z, static_cast<float>(voxel.z));
+uint32_t checksum(const uint8_t* data, size_t size) {
+    const bool swap = !hostIsLittleEndian();
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word = readValue<uint32_t>(data + i);
+        hash = (hash ^ (swap ? swap32(word) : word)) * 16777619u;
     }
+    return hash;
 }
 
+} // namespace
+
 bool VoxelModel::loadFromFile(const char* filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << filename << ": cannot open" << std::endl;
         return false;
     }
 
-    // Simple binary format:
-    // uint32_t: number of voxels
-    // For each voxel: x, y, z, type, r, g, b, a, health
-    uint32_t count;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    bool loaded = (size >= sizeof(FILE_MAGIC) && std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0)
+        ? loadVersion2(data, size, filename)
+        : loadVersion1(data, size, filename);
+    if (!loaded) {
+        clear();
+    }
+    return loaded;
+}
 
-    voxels_.clear();
-    voxels_.reserve(count);
-
-    for (uint32_t i = 0; i < count; ++i) {
-        Voxel v;
-        file.read(reinterpret_cast<char*>(&v.x), sizeof(v.x));
-        file.read(reinterpret_cast<char*>(&v.y), sizeof(v.y));
-        file.read(reinterpret_cast<char*>(&v.z), sizeof(v.z));
-        file.read(reinterpret_cast<char*>(&v.type), sizeof(v.type));
-        file.read(reinterpret_cast<char*>(&v.color.r), sizeof(v.color.r));
-        file.read(reinterpret_cast<char*>(&v.color.g), sizeof(v.color.g));
-        file.read(reinterpret_cast<char*>(&v.color.b), sizeof(v.color.b));
-        file.read(reinterpret_cast<char*>(&v.color.a), sizeof(v.color.a));
-        file.read(reinterpret_cast<char*>(&v.health), sizeof(v.health));
-        voxels_.push_back(v);
+bool VoxelModel::loadVersion1(const uint8_t* data, size_t size, const char* filename) {
+    if (size < sizeof(uint32_t)) {
+        std::cerr << filename << ": file too small" << std::endl;
+        return false;
+    }
+
+    // The record size is implied by the file size
+    uint64_t count = readValue<uint32_t>(data);
+    size_t recordSize;
+    if (size == sizeof(uint32_t) + count * 19) {
+        recordSize = 19;
+    } else if (size == sizeof(uint32_t) + count * 15) {
+        recordSize = 15;
+    } else {
+        std::cerr << filename << ": truncated or unrecognised v1 file" << std::endl;
+        return false;
+    }
+
+    clear();
+    voxels_.resize(count);
+    const uint8_t* record = data + sizeof(uint32_t);
+    for (Voxel& v : voxels_) {
+        v.x = readValue<int16_t>(record);
+        v.y = readValue<int16_t>(record + 2);
+        v.z = readValue<int16_t>(record + 4);
+        v.type = static_cast<VoxelType>(record[6]);
+        v.color = Color(record[7], record[8], record[9], record[10]);
+        v.setHealth(recordSize == 19 ? readValue<double>(record + 11) : readValue<float>(record + 11));
+        record += recordSize;
     }
 
+    rebuildIndex();
     return true;
 }
 
-bool VoxelModel::saveToFile(const char* filename) const {
+bool VoxelModel::loadVersion2(const uint8_t* data, size_t size, const char* filename) {
+    if (size < HEADER_SIZE) {
+        std::cerr << filename << ": truncated header" << std::endl;
+        return false;
+    }
+
+    uint16_t version = readValue<uint16_t>(data + 4);
+    uint16_t recordSize = readValue<uint16_t>(data + 6);
+    uint32_t marker = readValue<uint32_t>(data + 8);
+    uint32_t count = readValue<uint32_t>(data + 12);
+    uint32_t storedChecksum = readValue<uint32_t>(data + 16);
+
+    // A file written on a host of the other byte order
+    bool swapped = marker == swap32(ENDIAN_MARKER);
+    if (swapped) {
+        version = swap16(version);
+        recordSize = swap16(recordSize);
+        count = swap32(count);
+        storedChecksum = swap32(storedChecksum);
+    } else if (marker != ENDIAN_MARKER) {
+        std::cerr << filename << ": bad endian marker" << std::endl;
+        return false;
+    }
+
+    const uint8_t* payload = data + HEADER_SIZE;
+    if (version == FILE_VERSION_COMPRESSED) {
+        if (checksum(payload, size - HEADER_SIZE) != storedChecksum) {
+            std::cerr << filename << ": checksum mismatch" << std::endl;
+            return false;
+        }
+        CompressedVoxelModel compressed;
+        if (!compressed.deserialize(payload, size - HEADER_SIZE, swapped) || compressed.getVoxelCount() != count) {
+            std::cerr << filename << ": corrupt compressed payload" << std::endl;
+            return false;
+        }
+        compressed.decompress(*this);
+        return true;
+    }
+
+    if (version != FILE_VERSION || recordSize != sizeof(Voxel)) {
+        std::cerr << filename << ": unsupported version " << version << std::endl;
+        return false;
+    }
+    if (size != HEADER_SIZE + (uint64_t)count * sizeof(Voxel)) {
+        std::cerr << filename << ": truncated voxel records" << std::endl;
+        return false;
+    }
+
+    const uint8_t* records = payload;
+    if (checksum(records, size - HEADER_SIZE) != storedChecksum) {
+        std::cerr << filename << ": checksum mismatch" << std::endl;
+        return false;
+    }
+
+    // Records match the in-memory layout, so they are copied in one go
+    clear();
+    voxels_.resize(count);
+    std::memcpy(voxels_.data(), records, (size_t)count * sizeof(Voxel));
+    if (swapped) {
+        for (Voxel& v : voxels_) {
+            v.x = (int16_t)swap16((uint16_t)v.x);
+            v.y = (int16_t)swap16((uint16_t)v.y);
+            v.z = (int16_t)swap16((uint16_t)v.z);
+        }
+    }
+
+    rebuildIndex();
+    return true;
+}
+
+void VoxelModel::setVoxels(std::vector<Voxel> voxels) {
+    clear();
+    voxels_ = std::move(voxels);
+    rebuildIndex();
+}
+
+void VoxelModel::rebuildIndex() {
+    // Same rules as addVoxel: empty voxels are dropped and a later voxel at
+    // the same coordinate replaces the earlier one
+    uint32_t kept = 0;
+    for (size_t i = 0; i < voxels_.size(); ++i) {
+        const Voxel v = voxels_[i];
+        if (v.isEmpty()) {
+            continue;
+        }
+
+        uint32_t slot = index_.find(v.x, v.y, v.z);
+        if (slot != VoxelIndex::NONE) {
+            voxels_[slot] = v;
+            continue;
+        }
+        index_.insert(v.x, v.y, v.z, kept);
+        voxels_[kept++] = v;
+    }
+    voxels_.resize(kept);
+}
+
+bool VoxelModel::saveToFile(const char* filename, FileFormat format) const {
     std::ofstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         return false;
     }
 
     uint32_t count = static_cast<uint32_t>(voxels_.size());
-    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    std::vector<uint8_t> out;
 
-    for (const auto& v : voxels_) {
-        file.write(reinterpret_cast<const char*>(&v.x), sizeof(v.x));
-        file.write(reinterpret_cast<const char*>(&v.y), sizeof(v.y));
-        file.write(reinterpret_cast<const char*>(&v.z), sizeof(v.z));
-        file.write(reinterpret_cast<const char*>(&v.type), sizeof(v.type));
-        file.write(reinterpret_cast<const char*>(&v.color.r), sizeof(v.color.r));
-        file.write(reinterpret_cast<const char*>(&v.color.g), sizeof(v.color.g));
-        file.write(reinterpret_cast<const char*>(&v.color.b), sizeof(v.color.b));
-        file.write(reinterpret_cast<const char*>(&v.color.a), sizeof(v.color.a));
-        file.write(reinterpret_cast<const char*>(&v.health), sizeof(v.health));
+    if (format == FileFormat::V1) {
+        out.reserve(sizeof(count) + voxels_.size() * 19);
+        writeValue(out, count);
+        for (const auto& v : voxels_) {
+            writeValue(out, v.x);
+            writeValue(out, v.y);
+            writeValue(out, v.z);
+            writeValue(out, v.type);
+            writeValue(out, v.color.r);
+            writeValue(out, v.color.g);
+            writeValue(out, v.color.b);
+            writeValue(out, v.color.a);
+            writeValue(out, v.getHealth());
+        }
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+        return file.good();
     }
 
-    return true;
+    if (format == FileFormat::Compressed) {
+        CompressedVoxelModel compressed;
+        if (!compressed.compress(*this)) {
+            return false;
+        }
+        std::vector<uint8_t> payload;
+        compressed.serialize(payload);
+
+        out.insert(out.end(), FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+        writeValue(out, FILE_VERSION_COMPRESSED);
+        writeValue(out, (uint16_t)0);
+        writeValue(out, ENDIAN_MARKER);
+        writeValue(out, count);
+        writeValue(out, checksum(payload.data(), payload.size()));
+        writeValue(out, (uint32_t)0);
+
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        return file.good();
+    }
+
+    const uint8_t* records = reinterpret_cast<const uint8_t*>(voxels_.data());
+    const size_t recordBytes = voxels_.size() * sizeof(Voxel);
+
+    out.insert(out.end(), FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+    writeValue(out, FILE_VERSION);
+    writeValue(out, (uint16_t)sizeof(Voxel));
+    writeValue(out, ENDIAN_MARKER);
+    writeValue(out, count);
+    writeValue(out, checksum(records, recordBytes));
+    writeValue(out, (uint32_t)0);
+
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    file.write(reinterpret_cast<const char*>(records), recordBytes);
+    return file.good();
 }
 
 } // namespace SpaceGame
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <array>
 
 #include <glm/glm.hpp>
 
+#include "voxel_index.h"
+
 namespace SpaceGame {
 
+class JobSystem;
+
 // RGB color for voxels
 struct Color {
     uint8_t r, g, b, a;
@@ -28,37 +33,242 @@ enum class VoxelType : uint8_t {
     System          // Internal systems
 };
 
-// Single voxel with position and properties
+// Single voxel with position and properties. Packed into 12 bytes so the
+// renderer streams as little memory as possible per voxel.
 struct Voxel {
+    static constexpr uint8_t MAX_HEALTH = 255;
+
     int16_t x, y, z;        // Position in local space
     VoxelType type;
+    uint8_t health;         // Quantised 0 to MAX_HEALTH, for damage model
     Color color;
-    double health;           // 0.0 to 1.0, for damage model
 
-    Voxel() : x(0), y(0), z(0), type(VoxelType::Empty), health(1.0) {}
+    Voxel() : x(0), y(0), z(0), type(VoxelType::Empty), health(MAX_HEALTH) {}
     Voxel(int16_t x, int16_t y, int16_t z, VoxelType type, Color color)
-        : x(x), y(y), z(z), type(type), color(color), health(1.0) {}
+        : x(x), y(y), z(z), type(type), health(MAX_HEALTH), color(color) {}
+
+    bool isEmpty() const { return type == VoxelType::Empty || health == 0; }
+
+    // Health as a fraction, 0.0 to 1.0
+    double getHealth() const { return health / (double)MAX_HEALTH; }
+    void setHealth(double value);
+};
+
+static_assert(sizeof(Voxel) == 12, "Voxel should stay packed into 12 bytes");
+
+// Structure-of-arrays copy of voxel positions and colors, laid out so the
+// renderer's transform loop can stream each component independently
+struct VoxelSoA {
+    std::vector<int16_t> x, y, z;
+    std::vector<Color> color;
+
+    size_t size() const { return x.size(); }
+    void clear();
+    void reserve(size_t count);
+    void push_back(const Voxel& voxel);
+    size_t getMemoryUsage() const;
+};
+
+// Bytes held by each part of a VoxelModel
+struct MemoryFootprint {
+    size_t voxels = 0;      // Packed voxel array
+    size_t index = 0;       // Brick grid
+    size_t soa = 0;         // Structure-of-arrays copy
+    size_t surface = 0;     // Cached surface voxels
+    size_t mesh = 0;        // Cached greedy mesh
+    size_t occupancy = 0;   // Cached brick bitmasks
+    size_t lod = 0;         // Downsampled detail levels, all parts included
+
+    size_t total() const { return voxels + index + soa + surface + mesh + occupancy + lod; }
+};
+
+// Voxels of one brick that have at least one empty face neighbour
+struct SurfaceBrick {
+    uint32_t revision = 0;  // Brick revision the list was built from
+    VoxelSoA voxels;
+    glm::dvec3 boundsMin;   // Box enclosing the brick's voxel cubes
+    glm::dvec3 boundsMax;
+};
+
+// Rectangle of merged coplanar voxel faces sharing one color
+struct MeshQuad {
+    int16_t x, y, z;        // Voxel holding the face's minimum corner
+    uint8_t face;           // Outward normal: 0 -X, 1 +X, 2 -Y, 3 +Y, 4 -Z, 5 +Z
+    uint8_t width;          // Extent in voxels along axis (face / 2 + 1) % 3
+    uint8_t height;         // Extent in voxels along axis (face / 2 + 2) % 3
+    Color color;
+};
+
+// Greedy mesh of one brick
+struct BrickMesh {
+    uint32_t revision = 0;  // Brick revision the mesh was built from
+    uint32_t faces = 0;     // Exposed voxel faces before merging
+    std::vector<MeshQuad> quads;
+};
+
+// Occupied cells of one brick as a bitmask, bit i for VoxelIndex::cellIndex
+// i, so word z is the 8x8 slice at that depth within the brick
+struct BrickOccupancy {
+    static constexpr int WORDS = VoxelIndex::BRICK_VOLUME / 64;
+
+    uint32_t revision = 0;  // Brick revision the mask was built from
+    uint64_t bits[WORDS] = {};
+};
+
+// Primitive counts for a whole model
+struct MeshStats {
+    size_t faces = 0;
+    size_t quads = 0;
 
-    bool isEmpty() const { return type == VoxelType::Empty || health <= 0.0; }
+    size_t trianglesBefore() const { return faces * 2; }
+    size_t trianglesAfter() const { return quads * 2; }
 };
 
-// Voxel model - collection of voxels forming an object
+// Outcome of one damage call
+struct DamageResult {
+    uint32_t damaged = 0;       // Voxels that lost health and survived
+    uint32_t destroyed = 0;     // Voxels whose health reached zero, now removed
+};
+
+// Segment origin + t * direction for t in [0, maxDistance]
+struct Ray {
+    glm::dvec3 origin;
+    glm::dvec3 direction;
+    double maxDistance;
+};
+
+// First occupied voxel along a ray
+struct RayHit {
+    int16_t x, y, z;            // Voxel that was hit
+    uint8_t face;               // Face entered through, numbered as MeshQuad::face
+    double distance;            // Along the ray to the entry point, in model units
+};
+
+enum class FileFormat {
+    V1,         // Legacy headerless format, kept for older tools
+    V2,         // Versioned header, packed records and checksum
+    Compressed  // v3: v2 header, palette and run-length encoded bricks
+};
+
+// Voxel model - collection of voxels forming an object.
+// Voxels are stored contiguously; a brick index maps coordinates to slots so
+// lookups and edits are O(1) and each coordinate holds at most one voxel.
 class VoxelModel {
 public:
     VoxelModel();
 
+    // Replaces any voxel already at the same coordinate
     void addVoxel(const Voxel& voxel);
+    // Swap-removes, so the order of getVoxels() is not preserved
     void removeVoxel(int16_t x, int16_t y, int16_t z);
     const Voxel* getVoxel(int16_t x, int16_t y, int16_t z) const;
 
+    void clear();
+    void reserve(size_t count) { voxels_.reserve(count); }
+    // Replaces the contents in bulk; same rules as calling addVoxel in order
+    void setVoxels(std::vector<Voxel> voxels);
+
     const std::vector<Voxel>& getVoxels() const { return voxels_; }
+    // Rebuilt on first use after the model changes
+    const VoxelSoA& getSoA() const;
+
+    // Surface voxels grouped by brick, parallel to the index's bricks.
+    // Only bricks touched since the last call are rebuilt.
+    const std::vector<SurfaceBrick>& getSurface() const;
+    size_t getSurfaceVoxelCount() const;
+
+    // Greedy mesh grouped by brick, rebuilt per brick like the surface
+    const std::vector<BrickMesh>& getMesh() const;
+    MeshStats getMeshStats() const;
+
+    // Occupancy bitmasks parallel to the index's bricks, for collision
+    // tests; rebuilt per brick like the surface
+    const std::vector<BrickOccupancy>& getOccupancy() const;
+
+    const VoxelIndex& getIndex() const { return index_; }
+
+    static constexpr int MAX_LOD_LEVELS = 4;    // Level 0 plus three downsampled
+
+    // Detail level 0 is this model; each further level halves the
+    // resolution (see lod.h). Levels are built on first use after the model
+    // changes. level is clamped to MAX_LOD_LEVELS - 1.
+    const VoxelModel& getLod(int level) const;
+
+    // Reports the first occupied voxel along origin + t * direction for t in
+    // [0, maxDistance]. A 3D-DDA steps from brick to brick and only walks the
+    // voxels of bricks that hold any. direction need not be normalised;
+    // distances are in units of its length. Model space throughout.
+    bool raycast(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                 RayHit& hit) const;
+    // Casts count rays, split across the job system when one is given.
+    // found[i] says whether hits[i] was filled in. Returns the number of hits.
+    size_t raycast(const Ray* rays, size_t count, RayHit* hits, bool* found,
+                   JobSystem* jobs = nullptr) const;
+
+    // Damage is a fraction of full health. A blast deals the full amount at
+    // its centre, falling off linearly to nothing at radius; a ray hit deals
+    // it to the first voxel along the ray, reporting that voxel through hit.
+    // Voxels reaching zero health are removed. Only bricks that lost voxels
+    // are invalidated, so surfaces, meshes and bounds rebuild just those
+    // regions, and built detail levels are patched rather than discarded.
+    DamageResult applyBlast(const glm::dvec3& center, double radius, double damage);
+    DamageResult applyRayHit(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                             double damage, RayHit* hit = nullptr);
+
+    bool isOccupied(int16_t x, int16_t y, int16_t z) const {
+        return index_.find(x, y, z) != VoxelIndex::NONE;
+    }
+    // Box and sphere enclosing every voxel cube, in model space. Cached and
+    // recomputed from the per-brick bounds after edits.
     void getBounds(glm::dvec3& min, glm::dvec3& max) const;
+    void getBoundingSphere(glm::dvec3& center, double& radius) const;
 
+    // Reads v1 and v2 files; on failure the model is left empty
     bool loadFromFile(const char* filename);
-    bool saveToFile(const char* filename) const;
+    bool saveToFile(const char* filename, FileFormat format = FileFormat::V2) const;
+
+    MemoryFootprint getMemoryFootprint() const;
 
 private:
+    // Invalidates cached data for the voxel's brick and any brick sharing
+    // one of its faces. Detail levels are left to the caller.
+    void touch(int16_t x, int16_t y, int16_t z);
+    // removeVoxel without discarding the detail levels; false if absent
+    bool erase(int16_t x, int16_t y, int16_t z);
+    // Lowers the health of the voxel in slot by amount, in MAX_HEALTH units.
+    // Changed coordinates are appended to changed; destroyed ones also to
+    // destroyed, for the caller to erase once it is done with slots.
+    void damageSlot(uint32_t slot, int amount, DamageResult& result,
+                    std::vector<Voxel>& changed, std::vector<Voxel>& destroyed);
+    // Erases destroyed voxels and brings built detail levels up to date
+    // with the changed ones
+    void finishDamage(const std::vector<Voxel>& changed, const std::vector<Voxel>& destroyed);
+    void buildSurfaceBrick(const VoxelIndex::Brick& brick, SurfaceBrick& surface) const;
+    void updateBounds() const;
+
+    bool loadVersion1(const uint8_t* data, size_t size, const char* filename);
+    bool loadVersion2(const uint8_t* data, size_t size, const char* filename);
+    // Indexes voxels_ after a bulk load, dropping empty and duplicate voxels
+    void rebuildIndex();
+
     std::vector<Voxel> voxels_;
+    VoxelIndex index_;
+
+    mutable VoxelSoA soa_;
+    mutable bool soaDirty_;
+    mutable std::vector<SurfaceBrick> surface_;
+    mutable std::vector<BrickMesh> mesh_;
+    mutable std::vector<BrickOccupancy> occupancy_;
+    // Levels 1 and up. Shared so copies of the model can reuse them until
+    // either side is edited, which replaces rather than modifies the chain;
+    // damage patches a level in place only when no copy shares it.
+    mutable std::vector<std::shared_ptr<const VoxelModel>> lods_;
+    mutable bool lodsDirty_;
+
+    mutable bool boundsDirty_;
+    mutable glm::dvec3 boundsMin_, boundsMax_;
+    mutable glm::dvec3 sphereCenter_;
+    mutable double sphereRadius_;
 };
 
 } // namespace SpaceGame
@@ -0,0 +1,122 @@
+#include "voxel_index.h"
+
+namespace SpaceGame {
+
+VoxelIndex::VoxelIndex() {}
+
+uint32_t VoxelIndex::find(int16_t x, int16_t y, int16_t z) const {
+    uint32_t brick = findBrick(brickCoord(x), brickCoord(y), brickCoord(z));
+    if (brick == NONE) {
+        return NONE;
+    }
+    return bricks_[brick].slots[cellIndex(x, y, z)];
+}
+
+void VoxelIndex::insert(int16_t x, int16_t y, int16_t z, uint32_t slot) {
+    Brick& brick = bricks_[findOrCreateBrick(brickCoord(x), brickCoord(y), brickCoord(z))];
+    uint32_t& cell = brick.slots[cellIndex(x, y, z)];
+    if (cell == NONE) {
+        brick.count++;
+    }
+    cell = slot;
+}
+
+void VoxelIndex::erase(int16_t x, int16_t y, int16_t z) {
+    uint32_t index = findBrick(brickCoord(x), brickCoord(y), brickCoord(z));
+    if (index == NONE) {
+        return;
+    }
+    Brick& brick = bricks_[index];
+    uint32_t& cell = brick.slots[cellIndex(x, y, z)];
+    if (cell != NONE) {
+        cell = NONE;
+        brick.count--;
+    }
+}
+
+void VoxelIndex::clear() {
+    bricks_.clear();
+    table_.clear();
+}
+
+void VoxelIndex::touch(int16_t x, int16_t y, int16_t z) {
+    uint32_t index = findBrick(brickCoord(x), brickCoord(y), brickCoord(z));
+    if (index != NONE) {
+        bricks_[index].revision++;
+    }
+}
+
+size_t VoxelIndex::getMemoryUsage() const {
+    return bricks_.capacity() * sizeof(Brick) + table_.capacity() * sizeof(uint32_t);
+}
+
+uint32_t VoxelIndex::findBrick(int16_t bx, int16_t by, int16_t bz) const {
+    if (table_.empty()) {
+        return NONE;
+    }
+
+    size_t mask = table_.size() - 1;
+    for (size_t i = hashSlot(bx, by, bz); ; i = (i + 1) & mask) {
+        uint32_t index = table_[i];
+        if (index == NONE) {
+            return NONE;
+        }
+        const Brick& brick = bricks_[index];
+        if (brick.x == bx && brick.y == by && brick.z == bz) {
+            return index;
+        }
+    }
+}
+
+uint32_t VoxelIndex::findOrCreateBrick(int16_t bx, int16_t by, int16_t bz) {
+    uint32_t index = findBrick(bx, by, bz);
+    if (index != NONE) {
+        return index;
+    }
+
+    // Keep the load factor at or below one half
+    if ((bricks_.size() + 1) * 2 > table_.size()) {
+        rehash(table_.empty() ? 64 : table_.size() * 2);
+    }
+
+    Brick brick;
+    brick.x = bx;
+    brick.y = by;
+    brick.z = bz;
+    brick.count = 0;
+    brick.revision = 1;
+    brick.slots.fill(NONE);
+    index = (uint32_t)bricks_.size();
+    bricks_.push_back(brick);
+
+    size_t mask = table_.size() - 1;
+    size_t i = hashSlot(bx, by, bz);
+    while (table_[i] != NONE) {
+        i = (i + 1) & mask;
+    }
+    table_[i] = index;
+    return index;
+}
+
+size_t VoxelIndex::hashSlot(int16_t bx, int16_t by, int16_t bz) const {
+    uint64_t key = (uint64_t)(uint16_t)bx
+                 | ((uint64_t)(uint16_t)by << 16)
+                 | ((uint64_t)(uint16_t)bz << 32);
+    key *= 0x9E3779B97F4A7C15ull;
+    return (size_t)(key >> 32) & (table_.size() - 1);
+}
+
+void VoxelIndex::rehash(size_t capacity) {
+    table_.assign(capacity, NONE);
+    size_t mask = capacity - 1;
+    for (uint32_t index = 0; index < bricks_.size(); ++index) {
+        const Brick& brick = bricks_[index];
+        size_t i = hashSlot(brick.x, brick.y, brick.z);
+        while (table_[i] != NONE) {
+            i = (i + 1) & mask;
+        }
+        table_[i] = index;
+    }
+}
+
+} // namespace SpaceGame
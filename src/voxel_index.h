@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <array>
+
+namespace SpaceGame {
+
+// Sparse grid of 8x8x8 bricks mapping voxel coordinates to slots in a
+// VoxelModel's voxel array. Bricks are located through an open-addressing
+// hash on their packed coordinates, so every lookup is O(1).
+class VoxelIndex {
+public:
+    static constexpr int BRICK_SHIFT = 3;
+    static constexpr int BRICK_SIZE = 1 << BRICK_SHIFT;
+    static constexpr int BRICK_MASK = BRICK_SIZE - 1;
+    static constexpr int BRICK_VOLUME = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Brick {
+        int16_t x, y, z;        // Brick coordinate (voxel coordinate >> BRICK_SHIFT)
+        uint32_t count;         // Number of occupied cells
+        uint32_t revision;      // Bumped by touch(), lets caches detect stale bricks
+        std::array<uint32_t, BRICK_VOLUME> slots;
+    };
+
+    VoxelIndex();
+
+    // Returns the slot stored at the coordinate, or NONE
+    uint32_t find(int16_t x, int16_t y, int16_t z) const;
+
+    // Stores or replaces the slot for a coordinate
+    void insert(int16_t x, int16_t y, int16_t z, uint32_t slot);
+    void erase(int16_t x, int16_t y, int16_t z);
+    void clear();
+
+    // Marks the brick holding the coordinate as changed, if it exists
+    void touch(int16_t x, int16_t y, int16_t z);
+
+    size_t getMemoryUsage() const;
+
+    // Bricks are never released once created, so indices stay stable
+    const std::vector<Brick>& getBricks() const { return bricks_; }
+    uint32_t findBrick(int16_t bx, int16_t by, int16_t bz) const;
+
+    static int16_t brickCoord(int16_t v) { return (int16_t)(v >> BRICK_SHIFT); }
+    static int cellIndex(int16_t x, int16_t y, int16_t z) {
+        return ((z & BRICK_MASK) << (2 * BRICK_SHIFT)) | ((y & BRICK_MASK) << BRICK_SHIFT) | (x & BRICK_MASK);
+    }
+
+private:
+    uint32_t findOrCreateBrick(int16_t bx, int16_t by, int16_t bz);
+    size_t hashSlot(int16_t bx, int16_t by, int16_t bz) const;
+    void rehash(size_t capacity);
+
+    std::vector<Brick> bricks_;
+    std::vector<uint32_t> table_;   // Brick indices, NONE marks an empty bucket
+};
+
+} // namespace SpaceGame